@@ -13,6 +13,9 @@
 // Get these from your Firebase project settings
 #define FIREBASE_HOST "your-project-default-rtdb.firebaseio.com"
 #define FIREBASE_AUTH "your-database-secret-or-auth-token"
+// Telemetry REST endpoint; set to a local RTDB stand-in (e.g. "http://192.168.1.50:8080/")
+// to benchmark uploads. Plain http skips TLS.
+#define REST_BASE_URL FIREBASE_HOST
 
 // ===== SENSOR CONFIGURATION =====
 // INA219 I2C Address (default: 0x40)
@@ -31,6 +34,50 @@
 #define FIREBASE_UPDATE_INTERVAL 1000    // milliseconds - how often to upload data
 #define DISPLAY_UPDATE_INTERVAL 500      // milliseconds - how often to update display
 #define SENSOR_READ_INTERVAL 100         // milliseconds - how often to read sensor
+#define UPLOAD_JITTER 1000               // milliseconds - random extra delay per upload (fleet pacing)
+#define HEARTBEAT_INTERVAL 60000         // milliseconds - how often to write the /fleet summary
+#define UPLOAD_BACKOFF_MAX 60000         // milliseconds - longest pause after consecutive failed uploads
+
+// ===== LOAD CUTOFF CONFIGURATION =====
+// Relay/MOSFET output that disconnects the load when a short is detected
+#define CUTOFF_PIN 26                  // Driver output pin (-1 = simulated GPIO backend)
+#define CUTOFF_ACTIVE_HIGH true        // Output level that disconnects the load
+#define CUTOFF_FAULT_PIN -1            // Optional hardware fault input for ISR trip (-1 = disabled)
+#define CUTOFF_RESET_PIN 0             // Manual reset button, active LOW (-1 = disabled)
+#define CUTOFF_LATCHING false          // true = every trip locks out until reset
+#define CUTOFF_MAX_RETRIES 3           // Auto-retries before lockout
+#define CUTOFF_RETRY_BASE_MS 2000      // milliseconds - first retry delay, doubled per retry
+#define CUTOFF_RETRY_MAX_MS 60000      // milliseconds - retry backoff ceiling
+
+// ===== POWER MANAGEMENT =====
+// Low-power mode: automatic light sleep between samples (needs CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE), WiFi modem sleep, batched uploads
+#define LOW_POWER_MODE false
+#define LOW_POWER_SAMPLE_INTERVAL 100     // milliseconds - sample period in low-power mode
+#define DETECTION_LATENCY_BUDGET 100      // milliseconds - upper bound for the sample period
+#define LOW_POWER_UPLOAD_BATCH 6          // history samples per upload in low-power mode
+#define DISPLAY_BLANK_TIMEOUT 60000       // milliseconds - blank OLED after inactivity
+
+// ===== ROLLUPS & RETENTION =====
+// Minute/hour/day rollups are written under /rollups; raw samples are pruned
+#define RAW_RETENTION_DAYS 7              // days - raw /sensor_data kept this long
+#define MINUTE_ROLLUP_RETENTION_DAYS 14   // days - /rollups/minute kept this long
+#define PRUNE_INTERVAL 60000              // milliseconds - one prune batch per interval
+#define PRUNE_BATCH_SIZE 25               // nodes deleted per prune batch
+
+// ===== TIMEBASE =====
+// Monotonic microseconds + NTP-disciplined offset; corrections are slewed
+#define TIME_DISCIPLINE_INTERVAL 60000    // milliseconds - NTP reference poll once synced
+#define TIME_STEP_THRESHOLD_US 5000000    // microseconds - larger errors are stepped
+#define TIME_SLEW_MAX_PPM 500             // maximum slew rate
+
+// ===== ARC DETECTION =====
+// Periodic high-rate current capture + windowed FFT for arc-fault signatures
+#define ARC_DETECTION_ENABLED true
+#define ARC_FRAME_SIZE 128                // samples per frame (power of two, max 512)
+#define ARC_CAPTURE_INTERVAL 1000         // milliseconds - one frame per interval
+#define ARC_SCORE_THRESHOLD 0.5           // 0..1 arc signature score
+#define ARC_CONFIRM_FRAMES 3              // consecutive frames above threshold
 
 // ===== CALIBRATION SETTINGS =====
 // Choose the appropriate calibration for your measurement range
@@ -51,9 +98,7 @@
 #define AUTO_ALERT_HIDE 10000   // milliseconds - auto-hide alert after this time
 
 // ===== DEBUG CONFIGURATION =====
-#define DEBUG_MODE true         // Set to false to disable debug output
-#define DEBUG_SENSOR true       // Set to false to disable sensor debug output
-#define DEBUG_WIFI true         // Set to false to disable WiFi debug output
-#define DEBUG_FIREBASE true     // Set to false to disable Firebase debug output
+// Log level and the DEBUG_* category switches are build_flags in platformio.ini
+// (env:esp32doit-devkit-v1), so the firmware and lib/LogRing see the same values.
 
 #endif // CONFIG_H
\ No newline at end of file
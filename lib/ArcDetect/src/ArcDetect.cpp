@@ -0,0 +1,150 @@
+#include "ArcDetect.h"
+
+#include <math.h>
+
+#if __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define ARC_USE_ESP_DSP 1   // ESP-DSP assembly-optimized FFT
+#else
+#define ARC_USE_ESP_DSP 0   // Portable scalar FFT
+#endif
+
+static const float ARC_PI = 3.14159265358979f;
+
+bool ArcAnalyzer::begin() {
+#if ARC_USE_ESP_DSP
+  return dsps_fft2r_init_fc32(NULL, ARC_MAX_FRAME) == ESP_OK;
+#else
+  return true;
+#endif
+}
+
+const char* ArcAnalyzer::backendName() {
+  return ARC_USE_ESP_DSP ? "ESP-DSP" : "scalar";
+}
+
+void ArcAnalyzer::prepareWindow(int n) {
+  if (windowSize_ == n) return;
+#if ARC_USE_ESP_DSP
+  dsps_wind_hann_f32(window_, n);
+#else
+  for (int i = 0; i < n; i++) window_[i] = 0.5f - 0.5f * cosf(2.0f * ARC_PI * i / (n - 1));
+#endif
+  windowSize_ = n;
+}
+
+#if !ARC_USE_ESP_DSP
+// Portable in-place radix-2 FFT on interleaved complex data
+static void fftScalar(float* data, int n) {
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float re = data[2 * i], im = data[2 * i + 1];
+      data[2 * i] = data[2 * j]; data[2 * i + 1] = data[2 * j + 1];
+      data[2 * j] = re; data[2 * j + 1] = im;
+    }
+  }
+  for (int len = 2; len <= n; len <<= 1) {
+    float angle = -2.0f * ARC_PI / len;
+    float wr = cosf(angle), wi = sinf(angle);
+    for (int i = 0; i < n; i += len) {
+      float cr = 1.0f, ci = 0.0f;
+      for (int k = 0; k < len / 2; k++) {
+        int a = 2 * (i + k), b = 2 * (i + k + len / 2);
+        float tr = data[b] * cr - data[b + 1] * ci;
+        float ti = data[b] * ci + data[b + 1] * cr;
+        data[b] = data[a] - tr;
+        data[b + 1] = data[a + 1] - ti;
+        data[a] += tr;
+        data[a + 1] += ti;
+        float next = cr * wr - ci * wi;
+        ci = cr * wi + ci * wr;
+        cr = next;
+      }
+    }
+  }
+}
+#endif
+
+void ArcAnalyzer::analyze(const float* samples, int n, ArcFeatures& out) {
+  float mean = 0;
+  for (int i = 0; i < n; i++) mean += samples[i];
+  mean /= n;
+
+  prepareWindow(n);
+  float acSquares = 0;
+  for (int i = 0; i < n; i++) {
+    float ac = samples[i] - mean;
+    acSquares += ac * ac;
+    fft_[2 * i] = ac * window_[i];
+    fft_[2 * i + 1] = 0;
+  }
+  out.acRms = sqrtf(acSquares / n);
+
+#if ARC_USE_ESP_DSP
+  dsps_fft2r_fc32(fft_, n);
+  dsps_bit_rev_fc32(fft_, n);
+#else
+  fftScalar(fft_, n);
+#endif
+
+  // Power spectrum over bins 1..n/2-1 (DC was removed above)
+  int half = n / 2;
+  float total = 0, logSum = 0;
+  int band = 0;
+  for (int b = 0; b < ARC_BANDS; b++) out.bandEnergy[b] = 0;
+  for (int k = 1; k < half; k++) {
+    float re = fft_[2 * k], im = fft_[2 * k + 1];
+    float p = re * re + im * im;
+    while (band < ARC_BANDS - 1 && k >= scoring_.bandEdges[band + 1] * half) band++;
+    out.bandEnergy[band] += p;
+    total += p;
+    logSum += logf(p + 1e-12f);
+  }
+  int bins = half - 1;
+  out.flatness = total > 0 ? expf(logSum / bins) / (total / bins) : 0;
+  for (int b = 0; b < ARC_BANDS; b++) out.bandEnergy[b] = total > 0 ? out.bandEnergy[b] / total : 0;
+
+  // Arcing = broadband, high-frequency noise that is significant next to the load current
+  bool significant = out.acRms > scoring_.minNoiseA && out.acRms > scoring_.minNoiseRatio * fabsf(mean);
+  float highFrequency = out.bandEnergy[2] + out.bandEnergy[3];
+  out.score = significant ? 0.5f * highFrequency + 0.5f * out.flatness : 0;
+}
+
+// Deterministic pseudo-random noise in [-1, 1]
+static float traceNoise(uint32_t& state) {
+  state = state * 1664525UL + 1013904223UL;
+  return (state >> 8) / 8388607.5f - 1.0f;
+}
+
+const char* arcTraceName(ArcTrace trace) {
+  static const char* const NAMES[ARC_TRACE_COUNT] = {
+    "clean + ripple", "load step", "series arc noise", "intermittent contact"
+  };
+  return trace < ARC_TRACE_COUNT ? NAMES[trace] : "?";
+}
+
+bool arcTraceIsArc(ArcTrace trace) {
+  return trace == ARC_TRACE_SERIES_ARC || trace == ARC_TRACE_INTERMITTENT;
+}
+
+void arcSyntheticTrace(ArcTrace trace, float* out, int n) {
+  uint32_t seed = 12345;
+  for (int i = 0; i < n; i++) {
+    float ripple = 0.05f * sinf(2.0f * ARC_PI * 6.4f * i / n);
+    switch (trace) {
+      case ARC_TRACE_CLEAN: out[i] = 2.0f + ripple + 0.0005f * traceNoise(seed); break;
+      case ARC_TRACE_LOAD_STEP: out[i] = i < n / 2 ? 1.0f : 2.0f; break;
+      case ARC_TRACE_SERIES_ARC: out[i] = 2.0f + ripple + 0.2f * traceNoise(seed); break;
+      case ARC_TRACE_INTERMITTENT: out[i] = traceNoise(seed) > 0.8f ? 0.3f : 2.0f; break;
+      default: out[i] = 0; break;
+    }
+  }
+}
+
+uint16_t ina219ArcCaptureConfig(uint16_t config) {
+  config &= ~(INA219_CONFIG_SADC_MASK | INA219_CONFIG_MODE_MASK);
+  return config | INA219_CONFIG_SADC_9BIT | INA219_CONFIG_MODE_SHUNT_CONT;
+}
@@ -0,0 +1,68 @@
+// Spectral arc-fault scoring of high-rate current frames. Series arcs and
+// intermittent contacts show up as broadband current noise before a hard
+// short; ripple and load steps concentrate in the lowest band.
+#pragma once
+
+#include <stdint.h>
+
+const int ARC_BANDS = 4;
+const int ARC_MAX_FRAME = 512;
+
+struct ArcFeatures {
+  float bandEnergy[ARC_BANDS];  // Fraction of AC energy per band
+  float acRms;                  // Amperes
+  float flatness;               // 0 = pure tone, ~0.55 = white noise
+  float score;                  // 0..1 arc signature
+};
+
+struct ArcScoring {
+  float bandEdges[ARC_BANDS + 1];  // Fraction of Nyquist
+  float minNoiseA;                 // AC noise below this is ignored
+  float minNoiseRatio;             // ...or below this fraction of the load current
+};
+
+class ArcAnalyzer {
+ public:
+  explicit ArcAnalyzer(const ArcScoring& scoring) : scoring_(scoring) {}
+
+  // Sets up the FFT backend; false if ESP-DSP could not be initialized
+  bool begin();
+  static const char* backendName();
+
+  // Windowed FFT of one current frame -> band energies and arc score.
+  // n must be a power of two, 4 <= n <= ARC_MAX_FRAME.
+  void analyze(const float* samples, int n, ArcFeatures& out);
+
+ private:
+  void prepareWindow(int n);
+
+  ArcScoring scoring_;
+  alignas(16) float fft_[ARC_MAX_FRAME * 2];  // Interleaved re/im
+  alignas(16) float window_[ARC_MAX_FRAME];
+  int windowSize_ = 0;
+};
+
+// Synthetic traces for the self-test and the native tests
+enum ArcTrace {
+  ARC_TRACE_CLEAN,           // DC load + ripple + sensor noise
+  ARC_TRACE_LOAD_STEP,
+  ARC_TRACE_SERIES_ARC,      // Broadband noise on the load current
+  ARC_TRACE_INTERMITTENT,    // Random contact dropouts
+  ARC_TRACE_COUNT
+};
+const char* arcTraceName(ArcTrace trace);
+bool arcTraceIsArc(ArcTrace trace);
+void arcSyntheticTrace(ArcTrace trace, float* out, int n);
+
+// INA219 fast capture: shunt-only continuous conversions with a 9-bit ADC
+// (84us each). Bus range and gain are kept; only SADC and MODE change.
+const uint8_t INA219_REG_CONFIG = 0x00;
+const uint8_t INA219_REG_SHUNT_VOLTAGE = 0x01;
+const uint16_t INA219_CONFIG_SADC_MASK = 0x0078;        // Bits 6:3
+const uint16_t INA219_CONFIG_MODE_MASK = 0x0007;        // Bits 2:0
+const uint16_t INA219_CONFIG_SADC_9BIT = 0x0000;        // 84us conversion
+const uint16_t INA219_CONFIG_MODE_SHUNT_CONT = 0x0005;  // Shunt voltage, continuous
+const uint32_t INA219_CONVERSION_9BIT_US = 84;
+const float INA219_SHUNT_LSB_V = 10e-6f;                // Shunt voltage register LSB
+
+uint16_t ina219ArcCaptureConfig(uint16_t config);
@@ -0,0 +1,132 @@
+#include "LoadCutoff.h"
+
+LoadCutoff::LoadCutoff(const CutoffConfig& config, CutoffMicrosFn micros,
+                       CutoffWriteFn write, CutoffFaultFn fault)
+    : config_(config), micros_(micros), write_(write), fault_(fault) {}
+
+void LoadCutoff::begin() {
+  writeOutput(false);
+}
+
+void CUTOFF_ISR_ATTR LoadCutoff::lock() {
+#if defined(ESP_PLATFORM)
+  portENTER_CRITICAL_SAFE(&mux_);
+#else
+  while (lock_.test_and_set(std::memory_order_acquire)) {}
+#endif
+}
+
+void CUTOFF_ISR_ATTR LoadCutoff::unlock() {
+#if defined(ESP_PLATFORM)
+  portEXIT_CRITICAL_SAFE(&mux_);
+#else
+  lock_.clear(std::memory_order_release);
+#endif
+}
+
+void CUTOFF_ISR_ATTR LoadCutoff::writeOutput(bool disconnect) {
+  bool level = config_.activeHigh ? disconnect : !disconnect;
+  outputLevel_ = level;
+  if (write_) write_(level);
+}
+
+void CUTOFF_ISR_ATTR LoadCutoff::trip(uint32_t detectedAtUs) {
+  lock();
+  if (state_ != CUTOFF_ARMED) {
+    unlock();
+    return;
+  }
+  writeOutput(true);
+  uint32_t latency = micros_() - detectedAtUs;
+  lastLatencyUs_ = latency;
+  if (latency > maxLatencyUs_) maxLatencyUs_ = latency;
+  state_ = CUTOFF_TRIPPED;
+  tripPending_ = true;
+  unlock();
+}
+
+const char* LoadCutoff::stateName() const {
+  switch (state_) {
+    case CUTOFF_ARMED:   return "ARMED";
+    case CUTOFF_TRIPPED: return "TRIPPED";
+    case CUTOFF_LOCKOUT: return "LOCKOUT";
+  }
+  return "UNKNOWN";
+}
+
+// Re-close the load and re-arm the trip. State and output change together so
+// a trip from the ISR can't land between them and leave the load connected.
+void LoadCutoff::close(uint32_t nowMs) {
+  filterReset_ = true;   // Filter still holds samples taken while disconnected
+  reclosedAt_ = nowMs;
+  lock();
+  state_ = CUTOFF_ARMED;
+  writeOutput(false);
+  unlock();
+
+  // An edge-triggered fault input stays quiet if it is still asserted
+  if (fault_ && fault_()) trip(micros_());
+}
+
+bool LoadCutoff::reset(uint32_t nowMs) {
+  if (state_ == CUTOFF_ARMED) return false;
+  retryCount_ = 0;
+  close(nowMs);
+  return true;
+}
+
+bool LoadCutoff::consumeFilterReset() {
+  bool pending = filterReset_;
+  filterReset_ = false;
+  return pending;
+}
+
+// True once per press: the level must hold for the debounce time, and the
+// button must be released before it can fire again
+bool LoadCutoff::buttonPressed(uint32_t nowMs, bool down) {
+  if (down != buttonRaw_) {
+    buttonRaw_ = down;
+    buttonChangedAt_ = nowMs;
+    return false;
+  }
+  if (down == buttonStable_ || nowMs - buttonChangedAt_ < config_.resetDebounceMs) return false;
+  buttonStable_ = down;
+  return down;
+}
+
+uint8_t LoadCutoff::service(uint32_t nowMs, bool resetButtonDown) {
+  uint8_t events = 0;
+
+  if (tripPending_) {
+    tripPending_ = false;
+    tripCount_++;
+    events |= CUTOFF_EVENT_TRIPPED;
+
+    if (config_.latching || retryCount_ >= config_.maxRetries) {
+      state_ = CUTOFF_LOCKOUT;
+      events |= CUTOFF_EVENT_LOCKOUT;
+    } else {
+      uint32_t backoff = config_.retryBaseMs << retryCount_;
+      if (backoff > config_.retryMaxMs || backoff < config_.retryBaseMs) backoff = config_.retryMaxMs;
+      retryBackoffMs_ = backoff;
+      retryAt_ = nowMs + backoff;
+      retryCount_++;
+      events |= CUTOFF_EVENT_RETRY_SCHEDULED;
+    }
+  }
+
+  if (buttonPressed(nowMs, resetButtonDown) && reset(nowMs)) {
+    events |= CUTOFF_EVENT_RESET;
+  }
+
+  if (state_ == CUTOFF_TRIPPED && (int32_t)(nowMs - retryAt_) >= 0) {
+    close(nowMs);
+    events |= CUTOFF_EVENT_RECLOSED;
+  }
+
+  // A load that stays healthy after re-closing earns its retries back
+  if (state_ == CUTOFF_ARMED && retryCount_ > 0 && nowMs - reclosedAt_ > config_.retryClearMs) {
+    retryCount_ = 0;
+  }
+  return events;
+}
@@ -0,0 +1,115 @@
+// Load cutoff state machine: trip, auto-retry with backoff, lockout and reset.
+// Hardware access goes through the backend callbacks, so the same code runs
+// on the ESP32 and on the host (simulated GPIO backend, see test/test_load_cutoff).
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_attr.h>
+#include <freertos/FreeRTOS.h>
+#define CUTOFF_ISR_ATTR IRAM_ATTR
+#else
+#include <atomic>
+#define CUTOFF_ISR_ATTR
+#endif
+
+enum CutoffState {
+  CUTOFF_ARMED,     // Load connected, trip enabled
+  CUTOFF_TRIPPED,   // Load disconnected, waiting for auto-retry
+  CUTOFF_LOCKOUT    // Load disconnected until manual/remote reset
+};
+
+// Backend. A null write function is the simulated backend: the output level
+// is only recorded. Functions called from trip() must be ISR-safe (IRAM).
+typedef void (*CutoffWriteFn)(bool level);
+typedef bool (*CutoffFaultFn)();        // True while the fault input is asserted
+typedef uint32_t (*CutoffMicrosFn)();
+
+struct CutoffConfig {
+  bool activeHigh;            // Output level that disconnects the load
+  bool latching;              // Every trip locks out until reset
+  int maxRetries;             // Auto-retries before lockout
+  uint32_t retryBaseMs;       // First retry delay, doubled on each retry
+  uint32_t retryMaxMs;        // Upper bound for retry backoff
+  uint32_t retryClearMs;      // Healthy time after which the retry count clears
+  uint32_t resetDebounceMs;   // Reset button must be stable this long
+};
+
+// Bits returned by service(), so the caller can log and record events
+enum CutoffEvent : uint8_t {
+  CUTOFF_EVENT_TRIPPED = 1 << 0,          // A trip was actuated (see lastTripLatencyUs())
+  CUTOFF_EVENT_LOCKOUT = 1 << 1,
+  CUTOFF_EVENT_RETRY_SCHEDULED = 1 << 2,
+  CUTOFF_EVENT_RECLOSED = 1 << 3,         // Auto-retry re-closed the load
+  CUTOFF_EVENT_RESET = 1 << 4             // Reset button press re-closed the load
+};
+
+class LoadCutoff {
+ public:
+  LoadCutoff(const CutoffConfig& config, CutoffMicrosFn micros,
+             CutoffWriteFn write = nullptr, CutoffFaultFn fault = nullptr);
+
+  // Drives the output to the connected level
+  void begin();
+
+  // Disconnects the load. Safe from the sampling path or an ISR; bookkeeping
+  // is deferred to service(). detectedAtUs is the micros() of the detection.
+  void CUTOFF_ISR_ATTR trip(uint32_t detectedAtUs);
+
+  // Runs from the main loop: retry/backoff scheduling, lockout and the
+  // edge-triggered, debounced reset button. Returns CutoffEvent bits.
+  uint8_t service(uint32_t nowMs, bool resetButtonDown);
+
+  // Manual/remote reset: re-closes the load and clears the retry count.
+  // Returns false if the load is already connected.
+  bool reset(uint32_t nowMs);
+
+  CutoffState state() const { return state_; }
+  const char* stateName() const;
+  bool outputLevel() const { return outputLevel_; }
+  bool disconnected() const { return outputLevel_ == config_.activeHigh; }
+  uint32_t lastTripLatencyUs() const { return lastLatencyUs_; }
+  uint32_t maxTripLatencyUs() const { return maxLatencyUs_; }
+  uint32_t tripCount() const { return tripCount_; }
+  int retryCount() const { return retryCount_; }
+  uint32_t retryBackoffMs() const { return retryBackoffMs_; }
+
+  // True once after the load was re-closed (filters must drop stale samples)
+  bool consumeFilterReset();
+
+ private:
+  void CUTOFF_ISR_ATTR writeOutput(bool disconnect);
+  void CUTOFF_ISR_ATTR lock();
+  void CUTOFF_ISR_ATTR unlock();
+  void close(uint32_t nowMs);
+  bool buttonPressed(uint32_t nowMs, bool down);
+
+  CutoffConfig config_;
+  CutoffMicrosFn micros_;
+  CutoffWriteFn write_;
+  CutoffFaultFn fault_;
+
+  volatile CutoffState state_ = CUTOFF_ARMED;
+  volatile bool tripPending_ = false;
+  volatile bool outputLevel_ = false;
+  volatile uint32_t lastLatencyUs_ = 0;
+  volatile uint32_t maxLatencyUs_ = 0;
+
+  uint32_t tripCount_ = 0;
+  int retryCount_ = 0;
+  uint32_t retryAt_ = 0;
+  uint32_t retryBackoffMs_ = 0;
+  uint32_t reclosedAt_ = 0;
+  bool filterReset_ = false;
+
+  bool buttonRaw_ = false;
+  bool buttonStable_ = false;
+  uint32_t buttonChangedAt_ = 0;
+
+#if defined(ESP_PLATFORM)
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+#else
+  std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+#endif
+};
@@ -0,0 +1,85 @@
+#include "LogRing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+size_t logFormatLine(const LogRecord& record, char* out, size_t size) {
+  static const char LEVEL_CHARS[] = "-EWID";
+  char level = record.level < sizeof(LEVEL_CHARS) - 1 ? LEVEL_CHARS[record.level] : '?';
+  int length = snprintf(out, size, "[%lu][%c][%s] %s\n", (unsigned long)record.timeMs,
+                        level, record.category, record.message);
+  if (length < 0) return 0;
+  if ((size_t)length >= size) {
+    // Truncated: keep the line terminated
+    length = size - 1;
+    if (length > 0) out[length - 1] = '\n';
+  }
+  return length;
+}
+
+LogRing::LogRing(LogClockFn clock, uint32_t rateWindowMs, uint8_t rateBurst)
+    : clock_(clock), rateWindowMs_(rateWindowMs), rateBurst_(rateBurst), head_(0), tail_(0) {}
+
+bool LogRing::admit(LogSite& site, uint32_t now) {
+  if (now - site.windowStart >= rateWindowMs_) {
+    site.windowStart = now;
+    site.count = 0;
+  }
+  if (site.count >= rateBurst_) {
+    site.suppressed++;
+    suppressed_++;
+    return false;
+  }
+  site.count++;
+  return true;
+}
+
+bool LogRing::write(LogSite& site, uint8_t level, const char* category, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  bool written = vwrite(site, level, category, format, args);
+  va_end(args);
+  return written;
+}
+
+bool LogRing::vwrite(LogSite& site, uint8_t level, const char* category, const char* format, va_list args) {
+  uint32_t now = clock_();
+  if (!admit(site, now)) return false;
+
+  LogRecord local;
+  LogRecord* record = &local;
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  if (!syncSink_) {
+    if (head - tail_.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+      dropped_++;
+      return false;
+    }
+    record = &records_[head % LOG_RING_SIZE];
+  }
+
+  record->timeMs = now;
+  record->level = level;
+  record->category = category;
+  int length = vsnprintf(record->message, LOG_MSG_MAX, format, args);
+  if (site.suppressed > 0 && length >= 0 && length < LOG_MSG_MAX) {
+    snprintf(record->message + length, LOG_MSG_MAX - length, " (+%u suppressed)", site.suppressed);
+  }
+  site.suppressed = 0;
+
+  if (syncSink_) {
+    char line[LOG_LINE_MAX];
+    syncSink_(line, logFormatLine(*record, line, sizeof(line)));
+    return true;
+  }
+  head_.store(head + 1, std::memory_order_release);
+  if (notify_) notify_();
+  return true;
+}
+
+bool LogRing::pop(LogRecord& out) {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail == head_.load(std::memory_order_acquire)) return false;
+  memcpy(&out, &records_[tail % LOG_RING_SIZE], sizeof(out));
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
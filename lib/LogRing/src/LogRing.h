@@ -0,0 +1,120 @@
+// Non-blocking, rate-limited logging. Records are formatted into a lock-free
+// ring by the producer (loop task) and written out by a single consumer (the
+// drain task on the ESP32), so a slow UART never stalls the sample loop.
+//
+// Levels and categories are filtered at compile time. Set them with
+// build_flags in platformio.ini (e.g. -DLOG_LEVEL=2 -DDEBUG_SENSOR=false);
+// they must be visible to every translation unit, so a header included only by
+// main.cpp is not enough.
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Category switches for info/debug records; errors and warnings always pass
+#ifndef DEBUG_MODE
+#define DEBUG_MODE true
+#endif
+#ifndef DEBUG_SENSOR
+#define DEBUG_SENSOR true
+#endif
+#ifndef DEBUG_WIFI
+#define DEBUG_WIFI true
+#endif
+#ifndef DEBUG_FIREBASE
+#define DEBUG_FIREBASE true
+#endif
+#define LOG_CAT_SYSTEM   true
+#define LOG_CAT_SENSOR   (DEBUG_MODE && DEBUG_SENSOR)
+#define LOG_CAT_WIFI     (DEBUG_MODE && DEBUG_WIFI)
+#define LOG_CAT_FIREBASE (DEBUG_MODE && DEBUG_FIREBASE)
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 32        // Records buffered before new ones are dropped
+#endif
+#ifndef LOG_RATE_BURST
+#define LOG_RATE_BURST 5        // Records per log statement per rate window
+#endif
+const int LOG_MSG_MAX = 96;     // Characters per record (truncated beyond)
+const int LOG_LINE_MAX = LOG_MSG_MAX + 32;
+
+// A disabled LOG_* statement is a constant-false branch and compiles to nothing
+#define LOG_ENABLED(level, cat) ((level) <= LOG_LEVEL && ((level) <= LOG_LEVEL_WARN || LOG_CAT_##cat))
+#define LOG_TO(ring, level, cat, ...) do { \
+    if (LOG_ENABLED(level, cat)) { \
+      static LogSite logSite_; \
+      (ring).write(logSite_, level, #cat, __VA_ARGS__); \
+    } \
+  } while (0)
+
+struct LogRecord {
+  uint32_t timeMs;
+  uint8_t level;
+  const char* category;
+  char message[LOG_MSG_MAX];
+};
+
+// Per call site rate limiter, one static instance per LOG_* statement
+struct LogSite {
+  uint32_t windowStart;
+  uint8_t count;
+  uint16_t suppressed;
+};
+
+typedef uint32_t (*LogClockFn)();
+typedef void (*LogNotifyFn)();                       // A record was queued
+typedef void (*LogSinkFn)(const char* line, size_t length);
+
+// "[timeMs][L][CATEGORY] message\n", returns the length written
+size_t logFormatLine(const LogRecord& record, char* out, size_t size);
+
+class LogRing {
+ public:
+  LogRing(LogClockFn clock, uint32_t rateWindowMs = 1000, uint8_t rateBurst = LOG_RATE_BURST);
+
+  void setNotify(LogNotifyFn notify) { notify_ = notify; }
+
+  // Synchronous mode: write() formats and hands the line straight to the sink
+  // instead of queueing. This is the old blocking behaviour, kept so the loop
+  // time can be compared with and without the ring (-DLOG_SYNCHRONOUS=1).
+  void setSynchronousSink(LogSinkFn sink) { syncSink_ = sink; }
+
+  // Producer side. Returns false if the record was rate limited or dropped.
+  bool write(LogSite& site, uint8_t level, const char* category, const char* format, ...)
+      __attribute__((format(printf, 5, 6)));
+  bool vwrite(LogSite& site, uint8_t level, const char* category, const char* format, va_list args);
+
+  // Consumer side: copies out the oldest record
+  bool pop(LogRecord& out);
+  bool empty() const { return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire); }
+
+  uint32_t dropped() const { return dropped_; }        // Ring full
+  uint32_t suppressed() const { return suppressed_; }  // Rate limited
+
+ private:
+  bool admit(LogSite& site, uint32_t now);
+
+  LogClockFn clock_;
+  uint32_t rateWindowMs_;
+  uint8_t rateBurst_;
+  LogNotifyFn notify_ = nullptr;
+  LogSinkFn syncSink_ = nullptr;
+
+  // Single producer, single consumer
+  LogRecord records_[LOG_RING_SIZE];
+  std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> tail_;
+  uint32_t dropped_ = 0;
+  uint32_t suppressed_ = 0;
+};
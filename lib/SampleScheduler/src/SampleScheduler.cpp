@@ -0,0 +1,35 @@
+#include "SampleScheduler.h"
+
+SampleScheduler::SampleScheduler(uint32_t intervalMs, uint32_t latencyBudgetMs)
+    : intervalMs_(intervalMs < latencyBudgetMs ? intervalMs : latencyBudgetMs) {}
+
+void SampleScheduler::start(uint32_t nowMs) {
+  nextAt_ = nowMs;
+  overruns_ = 0;
+}
+
+uint32_t SampleScheduler::next(uint32_t nowMs) {
+  nextAt_ += intervalMs_;
+  int32_t remaining = (int32_t)(nextAt_ - nowMs);
+  if (remaining < 0) {
+    overruns_++;
+    nextAt_ = nowMs;
+    return 0;
+  }
+  return (uint32_t)remaining;
+}
+
+float estimateAverageCurrentMA(const PowerModel& model, float awakeFraction, bool lightSleep,
+                               bool wifiPowerSave, bool displayOn) {
+  if (!lightSleep) awakeFraction = 1.0f;
+  float draw = awakeFraction * model.activeCpuMA + (1.0f - awakeFraction) * model.lightSleepMA;
+  draw += wifiPowerSave ? model.wifiModemSleepMA : model.wifiAlwaysOnMA;
+  draw += model.sensorMA;
+  if (displayOn) draw += model.oledOnMA;
+  return draw;
+}
+
+float awakeFraction(uint64_t workUs, uint64_t elapsedUs) {
+  if (elapsedUs == 0 || workUs >= elapsedUs) return 1.0f;
+  return (float)workUs / (float)elapsedUs;
+}
@@ -0,0 +1,48 @@
+// Fixed-cadence sample scheduling and the supply current estimate used by
+// low-power mode. No hardware access; the caller does the actual waiting.
+#pragma once
+
+#include <stdint.h>
+
+class SampleScheduler {
+ public:
+  // The sample period is clamped to the detection latency budget
+  SampleScheduler(uint32_t intervalMs, uint32_t latencyBudgetMs);
+
+  void start(uint32_t nowMs);
+
+  // Advances to the next slot and returns how long to wait for it. A missed
+  // slot (blocking upload/reconnect) resyncs to now instead of bursting
+  // samples, counts an overrun and returns 0.
+  uint32_t next(uint32_t nowMs);
+
+  // Sample right away, e.g. after a fault input woke the CPU
+  void sampleNow(uint32_t nowMs) { nextAt_ = nowMs; }
+
+  uint32_t intervalMs() const { return intervalMs_; }
+  uint32_t nextAtMs() const { return nextAt_; }
+  uint32_t overruns() const { return overruns_; }
+
+ private:
+  uint32_t intervalMs_;
+  uint32_t nextAt_ = 0;
+  uint32_t overruns_ = 0;
+};
+
+// Approximate supply current figures (mA)
+struct PowerModel {
+  float activeCpuMA;         // CPU awake, radio idle
+  float lightSleepMA;
+  float wifiAlwaysOnMA;      // Extra draw with radio power save off
+  float wifiModemSleepMA;    // Average extra draw with DTIM modem sleep
+  float oledOnMA;
+  float sensorMA;
+};
+
+// Idle time is only counted at lightSleepMA when lightSleep is set (automatic
+// light sleep is enabled); otherwise the CPU idles awake at activeCpuMA.
+float estimateAverageCurrentMA(const PowerModel& model, float awakeFraction, bool lightSleep,
+                               bool wifiPowerSave, bool displayOn);
+
+// Fraction of elapsed time spent doing work, clamped to [0, 1]
+float awakeFraction(uint64_t workUs, uint64_t elapsedUs);
@@ -0,0 +1,84 @@
+#include "Retention.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char RAW_PATH[] = "sensor_data";
+static const char MINUTE_PATH[] = "rollups/minute";
+
+Retention::Retention(const RetentionConfig& config, UploadPipeline& pipeline, TelemetryWriter& writer,
+                     char* response, size_t responseSize)
+    : config_(config), pipeline_(pipeline), writer_(writer), response_(response), responseSize_(responseSize) {
+  if (config_.batchSize > RETENTION_BATCH_MAX) config_.batchSize = RETENTION_BATCH_MAX;
+}
+
+int Retention::queryKeys(const char* path, const char* startKey, const char* endKey, int limit,
+                         char (*out)[RETENTION_KEY_MAX]) {
+  static JsonDocument keyFilter;
+  if (keyFilter.isNull()) {
+    // Keep one small field per child; only the keys are needed
+    keyFilter["*"][KEY_TIMESTAMP] = true;
+    keyFilter["*"][KEY_SAMPLES] = true;
+  }
+
+  char query[160];
+  int length = snprintf(query, sizeof(query), "%s?orderBy=%%22%%24key%%22", path);
+  if (startKey) {
+    length += snprintf(query + length, sizeof(query) - length, "&startAt=%%22%s%%22", startKey);
+  }
+  snprintf(query + length, sizeof(query) - length, "&endAt=%%22%s%%22&limitToFirst=%d", endKey, limit);
+  if (pipeline_.get(query, response_, responseSize_) != 200) return -1;
+
+  writer_.begin();
+  if (deserializeJson(writer_.doc(), (const char*)response_, DeserializationOption::Filter(keyFilter))) {
+    return -1;   // Also a response truncated to the buffer
+  }
+  int count = 0;
+  for (JsonPair child : writer_.doc().as<JsonObject>()) {
+    if (count == limit) break;
+    const char* key = child.key().c_str();
+    if (strlen(key) >= RETENTION_KEY_MAX) {
+      skippedKeys_++;
+      continue;
+    }
+    if (out) snprintf(out[count], RETENTION_KEY_MAX, "%s", key);
+    count++;
+  }
+  return count;
+}
+
+int Retention::pruneOlderThan(const char* path, const char* cutoffKey) {
+  int count = queryKeys(path, nullptr, cutoffKey, config_.batchSize, keys_);
+  if (count <= 0) return count;
+
+  // null deletes the node
+  JsonObject root = writer_.begin();
+  const char* firstKey = keys_[0];
+  const char* lastKey = keys_[0];
+  for (int i = 0; i < count; i++) {
+    root[(const char*)keys_[i]] = nullptr;
+    if (strcmp(keys_[i], firstKey) < 0) firstKey = keys_[i];
+    if (strcmp(keys_[i], lastKey) > 0) lastKey = keys_[i];
+  }
+  if (writer_.finish() != TELEMETRY_OK || !pipeline_.send("PATCH", path)) return -1;
+
+  // The deleted range must come back empty
+  if (queryKeys(path, firstKey, lastKey, 1, nullptr) != 0) return -1;
+  return count;
+}
+
+int Retention::service(time_t now) {
+  // Rollups are keyed by epoch seconds, raw samples by 16 digit epoch us
+  char cutoffKey[RETENTION_KEY_MAX];
+  int deleted;
+  if (pruneMinutes_) {
+    snprintf(cutoffKey, sizeof(cutoffKey), "%ld", (long)(now - config_.minuteRollupDays * 86400L));
+    lastPath_ = MINUTE_PATH;
+  } else {
+    formatTimeKey(cutoffKey, sizeof(cutoffKey), (int64_t)(now - config_.rawDays * 86400L) * 1000000LL);
+    lastPath_ = RAW_PATH;
+  }
+  deleted = pruneOlderThan(lastPath_, cutoffKey);
+  pruneMinutes_ = !pruneMinutes_;
+  return deleted;
+}
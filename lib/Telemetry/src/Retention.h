@@ -0,0 +1,56 @@
+// Retention of raw samples and minute rollups: each service() call deletes
+// one small batch of expired nodes, alternating between /sensor_data and
+// /rollups/minute. Expired keys are found with an orderBy="$key" range query
+// and deleted with a multi-path PATCH of nulls, through the UploadPipeline's
+// transport (device namespace, retries and request metrics included).
+#pragma once
+
+#include <stddef.h>
+#include <time.h>
+#include "UploadPipeline.h"
+
+const int RETENTION_BATCH_MAX = 25;      // Nodes deleted per prune request
+const int RETENTION_KEY_MAX = 20;        // 16 digit epoch-us sample keys, epoch-second rollup keys
+
+struct RetentionConfig {
+  int rawDays;               // Raw /sensor_data samples kept this long
+  int minuteRollupDays;      // Minute buckets kept this long
+  int batchSize;             // Nodes per prune request, up to RETENTION_BATCH_MAX
+};
+
+class Retention {
+ public:
+  // response receives the range queries: one batch of full child nodes
+  // (about 140 bytes per raw sample)
+  Retention(const RetentionConfig& config, UploadPipeline& pipeline, TelemetryWriter& writer,
+            char* response, size_t responseSize);
+
+  // Fetches up to limit child keys of path in [startKey, endKey] (no lower
+  // bound if startKey is null) into out, if given. Keys that would not fit
+  // are skipped, never truncated. Returns the number found, or -1 on error.
+  int queryKeys(const char* path, const char* startKey, const char* endKey, int limit,
+                char (*out)[RETENTION_KEY_MAX]);
+
+  // Deletes up to batchSize children of path whose keys sort at or before
+  // cutoffKey, then checks the range is really gone. Returns the number
+  // deleted, or -1 on error.
+  int pruneOlderThan(const char* path, const char* cutoffKey);
+
+  // One prune batch, alternating between raw samples and minute rollups.
+  // Returns the number deleted from lastPath(), or -1 on error.
+  int service(time_t nowEpochSeconds);
+
+  const char* lastPath() const { return lastPath_; }
+  uint32_t skippedKeys() const { return skippedKeys_; }   // Unexpected (too long) keys seen
+
+ private:
+  RetentionConfig config_;
+  UploadPipeline& pipeline_;
+  TelemetryWriter& writer_;
+  char* response_;
+  size_t responseSize_;
+  char keys_[RETENTION_BATCH_MAX][RETENTION_KEY_MAX];
+  bool pruneMinutes_ = false;
+  const char* lastPath_ = "";
+  uint32_t skippedKeys_ = 0;
+};
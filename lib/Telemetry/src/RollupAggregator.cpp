@@ -0,0 +1,66 @@
+#include "RollupAggregator.h"
+
+const time_t ROLLUP_PERIODS[ROLLUP_LEVELS] = {60, 3600, 86400};
+const char* const ROLLUP_NAMES[ROLLUP_LEVELS] = {"minute", "hour", "day"};
+
+static void addToStats(RollupStats& stats, float value, bool first) {
+  if (first || value < stats.min) stats.min = value;
+  if (first || value > stats.max) stats.max = value;
+  stats.sum += value;
+}
+
+static void mergeStats(RollupStats& into, const RollupStats& from, bool first) {
+  if (first || from.min < into.min) into.min = from.min;
+  if (first || from.max > into.max) into.max = from.max;
+  into.sum += from.sum;
+}
+
+void mergeRollup(RollupBucket* into, const RollupBucket& from) {
+  if (from.samples == 0) return;
+  bool first = into->samples == 0;
+  mergeStats(into->voltage, from.voltage, first);
+  mergeStats(into->current, from.current, first);
+  mergeStats(into->power, from.power, first);
+  into->energyWh += from.energyWh;
+  into->faults += from.faults;
+  into->samples += from.samples;
+}
+
+RollupAggregator::RollupAggregator() {
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    open_[level] = RollupBucket();
+    open_[level].level = level;
+  }
+}
+
+int RollupAggregator::add(uint32_t nowMs, time_t epochSeconds, float voltage, float current, float power,
+                          bool shortCircuit, RollupBucket* closed) {
+  // Energy over the time since the previous reading, at this reading's power
+  double dtHours = haveLastSample_ ? (uint32_t)(nowMs - lastSampleMs_) / 3600000.0 : 0.0;
+  lastSampleMs_ = nowMs;
+  haveLastSample_ = true;
+  bool faultOnset = shortCircuit && !lastShortCircuit_;
+  lastShortCircuit_ = shortCircuit;
+
+  if (epochSeconds <= 0) return 0;
+
+  int closedCount = 0;
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    RollupBucket& bucket = open_[level];
+    time_t start = epochSeconds - epochSeconds % ROLLUP_PERIODS[level];
+    if (bucket.start != start) {
+      if (bucket.samples > 0) closed[closedCount++] = bucket;
+      bucket = RollupBucket();
+      bucket.level = level;
+      bucket.start = start;
+    }
+    bool first = bucket.samples == 0;
+    addToStats(bucket.voltage, voltage, first);
+    addToStats(bucket.current, current, first);
+    addToStats(bucket.power, power, first);
+    bucket.energyWh += power * dtHours;
+    if (faultOnset) bucket.faults++;
+    bucket.samples++;
+  }
+  return closedCount;
+}
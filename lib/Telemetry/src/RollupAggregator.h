@@ -0,0 +1,39 @@
+// Minute/hour/day rollups maintained on the device, so the dashboard can
+// chart any range from a bounded number of nodes under /rollups. Every
+// reading is folded into the open bucket of each level; buckets that close
+// are handed to the UploadPipeline queues.
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "TelemetryPayloads.h"
+
+const int ROLLUP_LEVELS = 3;
+enum RollupLevel : uint8_t { ROLLUP_MINUTE, ROLLUP_HOUR, ROLLUP_DAY };
+extern const time_t ROLLUP_PERIODS[ROLLUP_LEVELS];
+extern const char* const ROLLUP_NAMES[ROLLUP_LEVELS];
+
+// Combines two partial summaries of the same bucket (e.g. before and after a reboot)
+void mergeRollup(RollupBucket* into, const RollupBucket& from);
+
+class RollupAggregator {
+ public:
+  RollupAggregator();
+
+  // Folds one reading into the open buckets. epochSeconds is 0 while the
+  // clock is not set: the energy interval and the fault edge are still
+  // tracked, but nothing is bucketed. Buckets closed by this reading are
+  // copied to closed (room for ROLLUP_LEVELS); returns how many.
+  int add(uint32_t nowMs, time_t epochSeconds, float voltage, float current, float power,
+          bool shortCircuit, RollupBucket* closed);
+
+  // Open (partial) bucket of each level; samples is 0 until the first reading
+  RollupBucket* open() { return open_; }
+  const RollupBucket& open(int level) const { return open_[level]; }
+
+ private:
+  RollupBucket open_[ROLLUP_LEVELS];
+  uint32_t lastSampleMs_ = 0;
+  bool haveLastSample_ = false;
+  bool lastShortCircuit_ = false;
+};
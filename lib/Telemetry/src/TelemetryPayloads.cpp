@@ -0,0 +1,96 @@
+#include "TelemetryPayloads.h"
+
+#include <math.h>
+#include <stdio.h>
+
+double fixedPrecision(float value) {
+  return round(value * 1000.0) / 1000.0;
+}
+
+void formatTimeKey(char* out, size_t size, int64_t epochUs) {
+  snprintf(out, size, "%016lld", (long long)epochUs);
+}
+
+// Values and keys formatted into stack buffers are passed as char* so
+// ArduinoJson copies them into the pool; a const char* would be stored by
+// pointer and dangle once the buffer goes out of scope.
+void fillReading(JsonObject obj, int64_t epochUs, float v, float i, float p) {
+  if (epochUs > 0) {
+    char seconds[16];
+    snprintf(seconds, sizeof(seconds), "%lld", (long long)(epochUs / 1000000LL));
+    obj[KEY_TIMESTAMP] = (char*)seconds;
+    obj[KEY_TIMESTAMP_US] = epochUs;
+  }
+  obj[KEY_VOLTAGE] = fixedPrecision(v);
+  obj[KEY_CURRENT] = fixedPrecision(i);
+  obj[KEY_POWER] = fixedPrecision(p);
+}
+
+void fillLatest(JsonObject obj, int64_t epochUs, const LatestStatus& latest) {
+  fillReading(obj, epochUs, latest.voltage, latest.current, latest.power);
+  obj[KEY_SHORT_CIRCUIT] = latest.shortCircuit;
+  obj[KEY_CUTOFF_STATE] = latest.cutoffState;
+  obj[KEY_ARC_SCORE] = fixedPrecision(latest.arcScore);
+}
+
+void fillEvent(JsonObject obj, int64_t epochUs, const EventRecord& event) {
+  fillReading(obj, epochUs, event.voltage, event.current, event.power);
+  obj[KEY_SEVERITY] = "HIGH";
+  obj[KEY_CUTOFF_STATE] = event.cutoffState;
+  obj[KEY_TRIP_LATENCY] = event.tripLatencyUs;
+  obj[KEY_ARC_SCORE] = fixedPrecision(event.arcScore);
+}
+
+void fillHeartbeat(JsonObject obj, const HeartbeatStatus& heartbeat) {
+  obj[KEY_VOLTAGE] = fixedPrecision(heartbeat.voltage);
+  obj[KEY_CURRENT] = fixedPrecision(heartbeat.current);
+  obj[KEY_POWER] = fixedPrecision(heartbeat.power);
+  obj[KEY_STATUS] = heartbeat.status;
+  if (heartbeat.lastSeen > 0) obj[KEY_LAST_SEEN] = heartbeat.lastSeen;
+  obj[KEY_UPLOADS] = heartbeat.uploads;
+  obj[KEY_FAILED_UPLOADS] = heartbeat.failedUploads;
+  obj[KEY_TRIPS] = heartbeat.trips;
+  obj[KEY_RSSI] = heartbeat.rssi;
+}
+
+void addHistoryEntry(JsonObject root, int64_t epochUs, float v, float i, float p, bool shortCircuit) {
+  char key[20];
+  formatTimeKey(key, sizeof(key), epochUs);
+  JsonObject sample = root[(char*)key].to<JsonObject>();
+  fillReading(sample, epochUs, v, i, p);
+  sample[KEY_SHORT_CIRCUIT] = shortCircuit;
+}
+
+void addRollup(JsonObject root, const char* levelName, const RollupBucket& b) {
+  char key[24];
+  snprintf(key, sizeof(key), "%s/%ld", levelName, (long)b.start);
+  JsonObject obj = root[(char*)key].to<JsonObject>();
+  obj[KEY_V_MIN] = fixedPrecision(b.voltage.min);
+  obj[KEY_V_MAX] = fixedPrecision(b.voltage.max);
+  obj[KEY_V_MEAN] = fixedPrecision(b.voltage.sum / b.samples);
+  obj[KEY_I_MIN] = fixedPrecision(b.current.min);
+  obj[KEY_I_MAX] = fixedPrecision(b.current.max);
+  obj[KEY_I_MEAN] = fixedPrecision(b.current.sum / b.samples);
+  obj[KEY_P_MIN] = fixedPrecision(b.power.min);
+  obj[KEY_P_MAX] = fixedPrecision(b.power.max);
+  obj[KEY_P_MEAN] = fixedPrecision(b.power.sum / b.samples);
+  obj[KEY_ENERGY] = fixedPrecision(b.energyWh);
+  obj[KEY_FAULTS] = b.faults;
+  obj[KEY_SAMPLES] = b.samples;
+}
+
+bool readRollup(JsonObject obj, uint8_t level, time_t start, RollupBucket* b) {
+  if (obj.isNull()) return false;
+  uint32_t samples = obj[KEY_SAMPLES].as<uint32_t>();
+  if (samples == 0) return false;
+  *b = RollupBucket();
+  b->level = level;
+  b->start = start;
+  b->samples = samples;
+  b->voltage = {obj[KEY_V_MIN].as<float>(), obj[KEY_V_MAX].as<float>(), obj[KEY_V_MEAN].as<double>() * samples};
+  b->current = {obj[KEY_I_MIN].as<float>(), obj[KEY_I_MAX].as<float>(), obj[KEY_I_MEAN].as<double>() * samples};
+  b->power = {obj[KEY_P_MIN].as<float>(), obj[KEY_P_MAX].as<float>(), obj[KEY_P_MEAN].as<double>() * samples};
+  b->energyWh = obj[KEY_ENERGY].as<double>();
+  b->faults = obj[KEY_FAULTS].as<uint16_t>();
+  return true;
+}
@@ -0,0 +1,108 @@
+// Wire format of every RTDB payload. Builders take plain data so the same
+// code is exercised on the device and in the native tests.
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <ArduinoJson.h>
+
+// Fixed keys (stored by pointer, never copied into the pool)
+static const char KEY_TIMESTAMP[] = "timestamp";
+static const char KEY_TIMESTAMP_US[] = "timestampUs";
+static const char KEY_VOLTAGE[] = "voltage";
+static const char KEY_CURRENT[] = "current";
+static const char KEY_POWER[] = "power";
+static const char KEY_SHORT_CIRCUIT[] = "shortCircuit";
+static const char KEY_CUTOFF_STATE[] = "cutoffState";
+static const char KEY_SEVERITY[] = "severity";
+static const char KEY_TRIP_LATENCY[] = "tripLatencyUs";
+static const char KEY_V_MIN[] = "vMin";
+static const char KEY_V_MAX[] = "vMax";
+static const char KEY_V_MEAN[] = "vMean";
+static const char KEY_I_MIN[] = "iMin";
+static const char KEY_I_MAX[] = "iMax";
+static const char KEY_I_MEAN[] = "iMean";
+static const char KEY_P_MIN[] = "pMin";
+static const char KEY_P_MAX[] = "pMax";
+static const char KEY_P_MEAN[] = "pMean";
+static const char KEY_ENERGY[] = "energyWh";
+static const char KEY_FAULTS[] = "faults";
+static const char KEY_SAMPLES[] = "samples";
+static const char KEY_ARC_SCORE[] = "arcScore";
+static const char KEY_STATUS[] = "status";
+static const char KEY_LAST_SEEN[] = "lastSeen";
+static const char KEY_UPLOADS[] = "uploads";
+static const char KEY_FAILED_UPLOADS[] = "failedUploads";
+static const char KEY_TRIPS[] = "trips";
+static const char KEY_RSSI[] = "rssi";
+
+struct RollupStats {
+  float min;
+  float max;
+  double sum;
+};
+
+struct RollupBucket {
+  uint8_t level;
+  time_t start;        // Bucket start (epoch seconds), also the node key
+  uint32_t samples;
+  RollupStats voltage;
+  RollupStats current;
+  RollupStats power;
+  double energyWh;
+  uint16_t faults;     // Short circuit onsets in this bucket
+};
+
+struct LatestStatus {
+  float voltage;
+  float current;
+  float power;
+  bool shortCircuit;
+  const char* cutoffState;   // Must outlive serialization (state names are literals)
+  float arcScore;
+};
+
+struct EventRecord {
+  float voltage;
+  float current;
+  float power;
+  const char* cutoffState;
+  uint32_t tripLatencyUs;
+  float arcScore;
+};
+
+struct HeartbeatStatus {
+  float voltage;
+  float current;
+  float power;
+  const char* status;
+  long lastSeen;             // Epoch seconds, 0 = clock not set (omitted)
+  int uploads;
+  int failedUploads;
+  uint32_t trips;
+  int rssi;
+};
+
+// Round for the wire: 3 decimals matches the sensor resolution
+double fixedPrecision(float value);
+
+// RTDB node key for a capture time: zero-padded epoch us, sorts chronologically
+void formatTimeKey(char* out, size_t size, int64_t epochUs);
+
+// timestamp stays in epoch seconds for existing readers; timestampUs carries
+// full resolution. Both are omitted when epochUs is 0 (clock not set).
+void fillReading(JsonObject obj, int64_t epochUs, float v, float i, float p);
+
+void fillLatest(JsonObject obj, int64_t epochUs, const LatestStatus& latest);
+void fillEvent(JsonObject obj, int64_t epochUs, const EventRecord& event);
+void fillHeartbeat(JsonObject obj, const HeartbeatStatus& heartbeat);
+
+// Adds root/<time key> = reading, for a multi-path PATCH on /sensor_data
+void addHistoryEntry(JsonObject root, int64_t epochUs, float v, float i, float p, bool shortCircuit);
+
+// Adds root/<levelName>/<start> = bucket summary, for a multi-path PATCH on /rollups
+void addRollup(JsonObject root, const char* levelName, const RollupBucket& bucket);
+
+// Reads a bucket summary written by addRollup back (sums from mean * samples).
+// level and start come from the node path. False if obj holds no samples.
+bool readRollup(JsonObject obj, uint8_t level, time_t start, RollupBucket* bucket);
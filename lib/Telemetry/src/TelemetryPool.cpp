@@ -0,0 +1,34 @@
+#include "TelemetryPool.h"
+
+#include <string.h>
+
+void* TelemetryPool::allocate(size_t size) {
+  size_t total = blockSize(size);
+  if (used_ + total > size_) return nullptr;
+  uint8_t* block = pool_ + used_;
+  *(size_t*)block = size;
+  used_ += total;
+  if (used_ > peak_) peak_ = used_;
+  return block + HEADER;
+}
+
+void* TelemetryPool::reallocate(void* ptr, size_t newSize) {
+  if (!ptr) return allocate(newSize);
+  uint8_t* block = (uint8_t*)ptr - HEADER;
+  size_t oldSize = *(size_t*)block;
+  size_t offset = block - pool_;
+
+  // The most recent block grows or shrinks in place
+  if (offset + blockSize(oldSize) == used_) {
+    if (offset + blockSize(newSize) > size_) return nullptr;
+    used_ = offset + blockSize(newSize);
+    if (used_ > peak_) peak_ = used_;
+    *(size_t*)block = newSize;
+    return ptr;
+  }
+  if (newSize <= oldSize) return ptr;
+
+  void* moved = allocate(newSize);
+  if (moved) memcpy(moved, ptr, oldSize);
+  return moved;
+}
@@ -0,0 +1,33 @@
+// Bump allocator for ArduinoJson over caller-provided static storage, so
+// building a payload never touches the heap. Everything is released at once
+// by reset().
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+class TelemetryPool : public ArduinoJson::Allocator {
+ public:
+  // storage must be 8-byte aligned
+  TelemetryPool(uint8_t* storage, size_t size) : pool_(storage), size_(size) {}
+
+  void* allocate(size_t size) override;
+  void deallocate(void*) override {}
+  void* reallocate(void* ptr, size_t newSize) override;
+
+  void reset() { used_ = 0; }
+  size_t used() const { return used_; }
+  size_t capacity() const { return size_; }
+  size_t peak() const { return peak_; }
+  void resetPeak() { peak_ = 0; }
+
+ private:
+  static const size_t HEADER = 8;  // Keeps payload 8-byte aligned
+  static size_t blockSize(size_t size) { return (HEADER + size + 7) & ~(size_t)7; }
+
+  uint8_t* pool_;
+  size_t size_;
+  size_t used_ = 0;
+  size_t peak_ = 0;
+};
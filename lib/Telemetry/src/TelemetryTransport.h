@@ -0,0 +1,24 @@
+// HTTP transport under the upload pipeline. The device implementation wraps
+// HTTPClient on one keep-alive connection (src/main.cpp); the native tests
+// use a POSIX socket client against a local RTDB stand-in (tools/rtdb_standin.py).
+#pragma once
+
+#include <stddef.h>
+
+class TelemetryTransport {
+ public:
+  virtual ~TelemetryTransport() {}
+
+  // One request on the RTDB REST API. path is relative to the database root,
+  // has no ".json" suffix and may end in a query ("sensor_data?orderBy=..."). A 200 response body is copied to response (if
+  // given, truncated to responseSize). Returns the HTTP status, or a negative
+  // value if no response arrived (connect/send/read failure).
+  virtual int request(const char* method, const char* path, const char* body, size_t length,
+                      char* response, size_t responseSize) = 0;
+
+  // True if the next request reuses an open connection
+  virtual bool connected() = 0;
+
+  // Drops the connection, e.g. a stale keep-alive socket
+  virtual void disconnect() = 0;
+};
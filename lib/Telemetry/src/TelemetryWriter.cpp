@@ -0,0 +1,34 @@
+#include "TelemetryWriter.h"
+
+#include <string.h>
+
+JsonObject TelemetryWriter::begin() {
+  doc_.clear();
+  pool_.reset();
+  length_ = 0;
+  return doc_.to<JsonObject>();
+}
+
+TelemetryStatus TelemetryWriter::finish() {
+  if (doc_.overflowed()) {
+    length_ = 0;
+    return TELEMETRY_POOL_OVERFLOW;
+  }
+  length_ = serializeJson(doc_, buffer_, size_);
+  if (length_ == 0 || length_ >= size_ - 1) {
+    length_ = 0;
+    return TELEMETRY_BUFFER_OVERFLOW;
+  }
+  return TELEMETRY_OK;
+}
+
+TelemetryStatus TelemetryWriter::setRaw(const char* json) {
+  size_t length = strlen(json);
+  if (length >= size_) {
+    length_ = 0;
+    return TELEMETRY_BUFFER_OVERFLOW;
+  }
+  memcpy(buffer_, json, length + 1);
+  length_ = length;
+  return TELEMETRY_OK;
+}
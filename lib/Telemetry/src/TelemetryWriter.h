@@ -0,0 +1,40 @@
+// Serializes one payload at a time into a preallocated buffer, with the
+// JsonDocument drawing from a TelemetryPool.
+#pragma once
+
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "TelemetryPool.h"
+
+enum TelemetryStatus {
+  TELEMETRY_OK,
+  TELEMETRY_POOL_OVERFLOW,     // Document did not fit the pool
+  TELEMETRY_BUFFER_OVERFLOW    // Serialized payload did not fit the buffer
+};
+
+class TelemetryWriter {
+ public:
+  TelemetryWriter(TelemetryPool& pool, char* buffer, size_t size)
+      : pool_(pool), doc_(&pool), buffer_(buffer), size_(size) {}
+
+  // Clears the previous payload and returns the new root object
+  JsonObject begin();
+
+  // Serializes the document into the buffer; length() is 0 on failure
+  TelemetryStatus finish();
+
+  // Uses a preformatted JSON value as the payload (e.g. a bare string)
+  TelemetryStatus setRaw(const char* json);
+
+  JsonDocument& doc() { return doc_; }
+  TelemetryPool& pool() { return pool_; }
+  const char* data() const { return buffer_; }
+  size_t length() const { return length_; }
+
+ private:
+  TelemetryPool& pool_;
+  JsonDocument doc_;
+  char* buffer_;
+  size_t size_;
+  size_t length_ = 0;
+};
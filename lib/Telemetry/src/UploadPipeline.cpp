@@ -0,0 +1,310 @@
+#include "UploadPipeline.h"
+
+#include <stdio.h>
+#include <string.h>
+
+uint16_t uploadLatencyPercentile(const UploadStats& stats, int percent) {
+  uint16_t sorted[UPLOAD_LATENCY_SAMPLES];
+  int count = stats.latencyCount < UPLOAD_LATENCY_SAMPLES ? stats.latencyCount : UPLOAD_LATENCY_SAMPLES;
+  if (count == 0) return 0;
+  memcpy(sorted, stats.latencyMs, count * sizeof(uint16_t));
+  for (int i = 1; i < count; i++) {
+    uint16_t value = sorted[i];
+    int j = i - 1;
+    while (j >= 0 && sorted[j] > value) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = value;
+  }
+  int rank = (percent * count + 99) / 100;
+  return sorted[(rank > 1 ? rank : 1) - 1];
+}
+
+void UploadPacer::start(uint32_t nowMs, uint32_t seed) {
+  state_ = seed ? seed : 1;
+  slotMs_ = nowMs + (periodMs_ ? next() % periodMs_ : 0);
+  fireMs_ = slotMs_;
+}
+
+bool UploadPacer::due(uint32_t nowMs) {
+  if ((int32_t)(nowMs - fireMs_) < 0) return false;
+  // Next slot on the fixed schedule; the offset never carries over
+  slotMs_ += periodMs_;
+  while (periodMs_ && (int32_t)(nowMs - slotMs_) >= 0) slotMs_ += periodMs_;
+  fireMs_ = slotMs_ + next() % (jitterMs_ + 1);
+  return true;
+}
+
+uint32_t UploadPacer::next() {
+  state_ ^= state_ << 13;
+  state_ ^= state_ >> 17;
+  state_ ^= state_ << 5;
+  return state_;
+}
+
+UploadPipeline::UploadPipeline(const UploadConfig& config, TelemetryTransport& transport,
+                               TelemetryWriter& writer, Timebase& timebase, UploadClockFn clock)
+    : config_(config), transport_(transport), writer_(writer), timebase_(timebase), clock_(clock) {
+  stats_.windowStartMs = clock_();
+  rollups_[ROLLUP_MINUTE] = {minuteRollups_, UPLOAD_MINUTE_ROLLUP_MAX, 0};
+  rollups_[ROLLUP_HOUR] = {hourRollups_, UPLOAD_HOUR_ROLLUP_MAX, 0};
+  rollups_[ROLLUP_DAY] = {dayRollups_, UPLOAD_DAY_ROLLUP_MAX, 0};
+}
+
+void UploadPipeline::setDevicePrefix(const char* prefix) {
+  snprintf(prefix_, sizeof(prefix_), "%s", prefix);
+}
+
+bool UploadPipeline::queueSample(const HistorySample& sample) {
+  bool kept = historyCount_ < UPLOAD_HISTORY_MAX;
+  if (!kept) {
+    stats_.samplesLost++;
+    memmove(&history_[0], &history_[1], sizeof(HistorySample) * (UPLOAD_HISTORY_MAX - 1));
+    historyCount_--;
+  }
+  history_[historyCount_++] = sample;
+  return kept;
+}
+
+bool UploadPipeline::queueEvent(int64_t captureMonoUs, const EventRecord& event) {
+  bool kept = eventCount_ < UPLOAD_EVENT_MAX;
+  if (!kept) {
+    stats_.eventsLost++;
+    memmove(&events_[0], &events_[1], sizeof(PendingEvent) * (UPLOAD_EVENT_MAX - 1));
+    eventCount_--;
+  }
+  events_[eventCount_++] = {captureMonoUs, event};
+  return kept;
+}
+
+bool UploadPipeline::queueRollup(const RollupBucket& bucket) {
+  RollupQueue& queue = rollups_[bucket.level < ROLLUP_LEVELS ? bucket.level : (uint8_t)ROLLUP_MINUTE];
+  bool kept = queue.count < queue.capacity;
+  if (!kept) {
+    stats_.rollupsLost++;
+    memmove(&queue.slots[0], &queue.slots[1], sizeof(RollupBucket) * (queue.capacity - 1));
+    queue.count--;
+  }
+  queue.slots[queue.count++] = bucket;
+  return kept;
+}
+
+void UploadPipeline::setRollups(RollupAggregator* aggregator) {
+  aggregator_ = aggregator;
+}
+
+int UploadPipeline::pendingRollups() const {
+  int count = 0;
+  for (int level = 0; level < ROLLUP_LEVELS; level++) count += rollups_[level].count;
+  return count;
+}
+
+bool UploadPipeline::backingOff(uint32_t nowMs) const {
+  return backoffMs_ > 0 && nowMs - backoffStartMs_ < backoffMs_;
+}
+
+bool UploadPipeline::due(uint32_t nowMs) const {
+  return historyCount_ >= config_.batchSize && !backingOff(nowMs);
+}
+
+void UploadPipeline::recordLatency(uint32_t elapsedMs, bool cold) {
+  if (cold) {
+    stats_.coldRequests++;
+    stats_.coldTotalMs += elapsedMs;
+  } else {
+    stats_.warmTotalMs += elapsedMs;
+  }
+  // Keep the most recent samples once the window is full
+  stats_.latencyMs[stats_.latencyCount % UPLOAD_LATENCY_SAMPLES] = elapsedMs > 0xFFFF ? 0xFFFF : elapsedMs;
+  if (++stats_.latencyCount == 2 * UPLOAD_LATENCY_SAMPLES) stats_.latencyCount = UPLOAD_LATENCY_SAMPLES;
+}
+
+void UploadPipeline::resetStats(uint32_t nowMs) {
+  stats_ = {};
+  stats_.windowStartMs = nowMs;
+}
+
+int UploadPipeline::request(const char* method, const char* path, bool deviceScoped,
+                            const char* body, size_t length, char* response, size_t responseSize) {
+  if (path[0] == '/') path++;
+  snprintf(path_, sizeof(path_), "%s%s", deviceScoped ? prefix_ : "", path);
+
+  int status = -1;
+  for (int attempt = 1; attempt <= config_.maxAttempts; attempt++) {
+    bool cold = !transport_.connected();
+    uint32_t start = clock_();
+    status = transport_.request(method, path_, body, length, response, responseSize);
+    stats_.requests++;
+    recordLatency(clock_() - start, cold);
+    // Only connection-level errors are retried right away; server errors wait for the next upload
+    if (status >= 0 || attempt == config_.maxAttempts) break;
+    stats_.retries++;
+    transport_.disconnect();
+  }
+
+  lastStatus_ = status;
+  if (status != 200) {
+    stats_.failures++;
+  } else {
+    stats_.bytesSent += length;
+  }
+  return status;
+}
+
+bool UploadPipeline::send(const char* method, const char* path, bool deviceScoped) {
+  if (writer_.length() == 0) return false;
+  return request(method, path, deviceScoped, writer_.data(), writer_.length(), nullptr, 0) == 200;
+}
+
+int UploadPipeline::get(const char* path, char* out, size_t outSize, bool deviceScoped) {
+  out[0] = '\0';
+  return request("GET", path, deviceScoped, nullptr, 0, out, outSize);
+}
+
+bool UploadPipeline::flushEvents() {
+  if (!timebase_.synced()) return true;
+
+  int sent = 0;
+  bool ok = true;
+  while (sent < eventCount_) {
+    const PendingEvent& event = events_[sent];
+    int64_t epochUs = timebase_.epochUsAt(event.captureMonoUs);
+    if (epochUs <= lastEventEpochUs_) epochUs = lastEventEpochUs_ + 1;
+
+    char eventPath[48];
+    snprintf(eventPath, sizeof(eventPath), "short_circuit_events/");
+    formatTimeKey(eventPath + strlen(eventPath), sizeof(eventPath) - strlen(eventPath), epochUs);
+    fillEvent(writer_.begin(), epochUs, event.record);
+    if (writer_.finish() != TELEMETRY_OK) lastFailedSteps_ |= UPLOAD_STEP_PAYLOAD;
+    if (!send("PUT", eventPath)) {
+      ok = false;
+      break;
+    }
+    lastEventEpochUs_ = epochUs;
+    sent++;
+  }
+
+  if (sent > 0) {
+    memmove(&events_[0], &events_[sent], sizeof(PendingEvent) * (eventCount_ - sent));
+    eventCount_ -= sent;
+  }
+  return ok;
+}
+
+// All queued samples in one multi-path PATCH, keyed by capture time
+bool UploadPipeline::sendHistory() {
+  JsonObject root = writer_.begin();
+  for (int i = 0; i < historyCount_; i++) {
+    const HistorySample& sample = history_[i];
+    addHistoryEntry(root, timebase_.epochUsAt(sample.sampleMonoUs), sample.voltage, sample.current,
+                    sample.power, sample.shortCircuit);
+  }
+  if (writer_.finish() != TELEMETRY_OK) lastFailedSteps_ |= UPLOAD_STEP_PAYLOAD;
+  if (!send("PATCH", "sensor_data")) return false;
+  stats_.samplesDelivered += historyCount_;
+  historyCount_ = 0;
+  return true;
+}
+
+// The first bucket of each level seen since boot (the oldest queued one, or
+// the open one) may already be on the server from before the reboot. It is
+// read back once and merged in; until that GET succeeds nothing is sent.
+bool UploadPipeline::seedRollups() {
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    if (rollupSeeded_[level]) continue;
+    RollupBucket* bucket = nullptr;
+    if (rollups_[level].count > 0) {
+      bucket = &rollups_[level].slots[0];
+    } else if (aggregator_ && aggregator_->open(level).samples > 0) {
+      bucket = &aggregator_->open()[level];
+    }
+    if (!bucket) continue;
+
+    char path[40];
+    snprintf(path, sizeof(path), "rollups/%s/%ld", ROLLUP_NAMES[level], (long)bucket->start);
+    if (get(path, response_, sizeof(response_)) != 200) return false;
+    writer_.begin();
+    RollupBucket stored;
+    if (!deserializeJson(writer_.doc(), response_) &&
+        readRollup(writer_.doc().as<JsonObject>(), level, bucket->start, &stored)) {
+      mergeRollup(bucket, stored);
+    }
+    rollupSeeded_[level] = true;
+  }
+  return true;
+}
+
+// Closed buckets oldest first (days, hours, then minutes) and the open
+// (partial) ones last, as multi-path PATCHes on /rollups of up to
+// UPLOAD_ROLLUP_BATCH buckets. Sent buckets leave the queues batch by batch.
+bool UploadPipeline::sendRollups() {
+  if (!seedRollups()) return false;
+
+  uint8_t openLevels = 0;
+  for (int level = 0; level < ROLLUP_LEVELS && aggregator_; level++) {
+    if (aggregator_->open(level).samples > 0) openLevels |= 1 << level;
+  }
+  for (;;) {
+    JsonObject root = writer_.begin();
+    int taken[ROLLUP_LEVELS] = {};
+    int count = 0;
+    for (int level = ROLLUP_LEVELS - 1; level >= 0; level--) {
+      const RollupQueue& queue = rollups_[level];
+      while (taken[level] < queue.count && count < UPLOAD_ROLLUP_BATCH) {
+        addRollup(root, ROLLUP_NAMES[level], queue.slots[taken[level]++]);
+        count++;
+      }
+    }
+    uint8_t sentOpen = 0;
+    if (count == 0 || pendingRollups() == count) {
+      for (int level = 0; level < ROLLUP_LEVELS && count < UPLOAD_ROLLUP_BATCH; level++) {
+        if (!(openLevels & (1 << level))) continue;
+        addRollup(root, ROLLUP_NAMES[level], aggregator_->open(level));
+        sentOpen |= 1 << level;
+        count++;
+      }
+    }
+    if (count == 0) return true;
+
+    if (writer_.finish() != TELEMETRY_OK) lastFailedSteps_ |= UPLOAD_STEP_PAYLOAD;
+    if (!send("PATCH", "rollups")) return false;
+    for (int level = 0; level < ROLLUP_LEVELS; level++) {
+      RollupQueue& queue = rollups_[level];
+      memmove(&queue.slots[0], &queue.slots[taken[level]], sizeof(RollupBucket) * (queue.count - taken[level]));
+      queue.count -= taken[level];
+    }
+    openLevels &= ~sentOpen;
+  }
+}
+
+bool UploadPipeline::upload(const LatestStatus& latest, int64_t latestMonoUs) {
+  lastFailedSteps_ = 0;
+
+  // Latest readings for the real-time display, sent even before the clock is set
+  fillLatest(writer_.begin(), timebase_.synced() ? timebase_.epochUsAt(latestMonoUs) : 0, latest);
+  if (writer_.finish() != TELEMETRY_OK) lastFailedSteps_ |= UPLOAD_STEP_PAYLOAD;
+  if (!send("PATCH", "latest")) lastFailedSteps_ |= UPLOAD_STEP_LATEST;
+
+  // Events captured while offline or before the clock was synced
+  if (!flushEvents()) lastFailedSteps_ |= UPLOAD_STEP_EVENTS;
+
+  // History keys are capture times, so the batch is held until the clock is synced
+  if (historyCount_ > 0 && timebase_.synced() && !sendHistory()) {
+    lastFailedSteps_ |= UPLOAD_STEP_HISTORY;
+  }
+
+  if (!sendRollups()) lastFailedSteps_ |= UPLOAD_STEP_ROLLUPS;
+
+  if (lastFailedSteps_ == 0) {
+    consecutiveFailures_ = 0;
+    backoffMs_ = 0;
+    return true;
+  }
+  // Back off exponentially; samples keep queuing (oldest dropped) meanwhile
+  if (consecutiveFailures_ < 4) consecutiveFailures_++;
+  uint32_t backoff = config_.intervalMs << consecutiveFailures_;
+  backoffMs_ = backoff < config_.backoffMaxMs ? backoff : config_.backoffMaxMs;
+  backoffStartMs_ = clock_();
+  return false;
+}
@@ -0,0 +1,201 @@
+// Upload queues, batching and backoff on top of a TelemetryTransport.
+// Samples, short circuit events and closed rollup buckets are queued with
+// their monotonic capture time and converted to epoch time when they are
+// sent, so nothing is lost or mis-stamped while offline or before the clock
+// is synced. No Arduino dependencies: the same pipeline runs on the device
+// and against the local RTDB stand-in in the native tests.
+#pragma once
+
+#include <stdint.h>
+#include <Timebase.h>
+#include "RollupAggregator.h"
+#include "TelemetryPayloads.h"
+#include "TelemetryTransport.h"
+#include "TelemetryWriter.h"
+
+const int UPLOAD_HISTORY_MAX = 12;       // Samples waiting for upload
+const int UPLOAD_EVENT_MAX = 8;          // Short circuit events waiting for upload
+// Closed rollup buckets waiting for upload, one queue per level so a long
+// outage only ever pushes out minute buckets: the hour and day queues cover
+// two days and a month offline
+const int UPLOAD_MINUTE_ROLLUP_MAX = 4;
+const int UPLOAD_HOUR_ROLLUP_MAX = 48;
+const int UPLOAD_DAY_ROLLUP_MAX = 31;
+const int UPLOAD_ROLLUP_BATCH = 6;       // Buckets per PATCH, well within the telemetry buffer
+const int UPLOAD_LATENCY_SAMPLES = 64;   // Latencies kept for the percentiles
+
+typedef uint32_t (*UploadClockFn)();     // Milliseconds
+
+struct UploadConfig {
+  uint32_t intervalMs;       // Sample cadence, also the first backoff step
+  uint32_t backoffMaxMs;     // Cap on the pause after consecutive failed uploads
+  int batchSize;             // Samples queued before an upload is due
+  int maxAttempts;           // Per request; only connection errors are retried
+};
+
+struct HistorySample {
+  int64_t sampleMonoUs;      // Monotonic capture time, converted to epoch at upload
+  float voltage;
+  float current;
+  float power;
+  bool shortCircuit;
+};
+
+// Request metrics, reset with each stats report. Latencies cover one HTTP
+// exchange; "cold" requests had to open a new connection (TCP + TLS handshake).
+struct UploadStats {
+  uint32_t requests;
+  uint32_t retries;
+  uint32_t failures;
+  uint32_t coldRequests;
+  uint32_t coldTotalMs;
+  uint32_t warmTotalMs;
+  uint32_t bytesSent;
+  uint32_t samplesDelivered;       // History samples acknowledged by the server
+  uint32_t samplesLost;            // History samples dropped from a full queue
+  uint32_t rollupsLost;
+  uint32_t eventsLost;             // Short circuit events dropped from a full queue
+  uint32_t windowStartMs;
+  uint16_t latencyMs[UPLOAD_LATENCY_SAMPLES];
+  uint8_t latencyCount;
+};
+
+// Nearest-rank percentile of the recorded latencies
+uint16_t uploadLatencyPercentile(const UploadStats& stats, int percent);
+
+// Parts of an upload cycle that failed, see UploadPipeline::lastFailedSteps()
+enum UploadStep : uint8_t {
+  UPLOAD_STEP_LATEST = 1 << 0,
+  UPLOAD_STEP_EVENTS = 1 << 1,
+  UPLOAD_STEP_HISTORY = 1 << 2,
+  UPLOAD_STEP_ROLLUPS = 1 << 3,
+  UPLOAD_STEP_PAYLOAD = 1 << 4     // Payload did not fit the telemetry pool/buffer
+};
+
+// Per-device pacing of a periodic write. Each board keeps a fixed schedule of
+// slots one period apart, starting at its own phase, and fires each slot
+// after a random offset, so a fleet booted together (e.g. after a power cut)
+// doesn't hit the backend in lockstep while the average rate stays 1/period.
+class UploadPacer {
+ public:
+  // jitterMs should be below periodMs
+  UploadPacer(uint32_t periodMs, uint32_t jitterMs) : periodMs_(periodMs), jitterMs_(jitterMs) {}
+
+  // First slot at a seed-derived phase within one period of nowMs
+  void start(uint32_t nowMs, uint32_t seed);
+
+  // True once per slot, up to jitterMs after it. Slots missed while the
+  // caller was blocked are skipped, not fired in a burst.
+  bool due(uint32_t nowMs);
+
+ private:
+  uint32_t next();
+
+  uint32_t periodMs_;
+  uint32_t jitterMs_;
+  uint32_t slotMs_ = 0;      // Start of the current slot
+  uint32_t fireMs_ = 0;      // Slot start plus this slot's offset
+  uint32_t state_ = 1;       // xorshift32, never 0
+};
+
+class UploadPipeline {
+ public:
+  UploadPipeline(const UploadConfig& config, TelemetryTransport& transport, TelemetryWriter& writer,
+                 Timebase& timebase, UploadClockFn clock);
+
+  // Namespace of device-scoped paths, e.g. "devices/esp32-0123456789ab/"
+  void setDevicePrefix(const char* prefix);
+
+  // Queues drop their oldest entry when full; these return false when they did.
+  // Rollup buckets go to the queue of their level.
+  bool queueSample(const HistorySample& sample);
+  bool queueEvent(int64_t captureMonoUs, const EventRecord& event);
+  bool queueRollup(const RollupBucket& bucket);
+
+  // Source of the open (partial) buckets, sent with every rollup upload
+  void setRollups(RollupAggregator* aggregator);
+
+  // A batch is queued and no backoff is pending
+  bool due(uint32_t nowMs) const;
+  bool backingOff(uint32_t nowMs) const;
+
+  // One upload cycle: /latest, queued events, the history batch (PATCH on
+  // /sensor_data) and rollups. Events and history wait for the clock. Returns
+  // true if every step succeeded; failures back off exponentially.
+  // The first rollup upload after boot reads back the server's copy of each
+  // level's first bucket and merges it in, so a reboot mid-bucket doesn't
+  // replace the summary with post-boot readings only.
+  bool upload(const LatestStatus& latest, int64_t latestMonoUs);
+
+  // Sends queued events oldest first; stops at the first failure and keeps
+  // the rest. Returns false only if a request failed (waiting for the clock
+  // is not a failure).
+  bool flushEvents();
+
+  // The writer's payload to path (relative to the device namespace unless
+  // deviceScoped is false), retrying connection errors. True on HTTP 200.
+  bool send(const char* method, const char* path, bool deviceScoped = true);
+
+  // Reads a small node as raw JSON. path may carry a query after '?'.
+  // Returns the HTTP status or a negative error.
+  int get(const char* path, char* out, size_t outSize, bool deviceScoped = true);
+
+  int lastStatus() const { return lastStatus_; }
+  uint8_t lastFailedSteps() const { return lastFailedSteps_; }
+  int consecutiveFailures() const { return consecutiveFailures_; }
+  uint32_t backoffMs() const { return backoffMs_; }
+  int pendingSamples() const { return historyCount_; }
+  int pendingEvents() const { return eventCount_; }
+  int pendingRollups() const;
+  int pendingRollups(int level) const { return rollups_[level].count; }
+
+  const UploadStats& stats() const { return stats_; }
+  void resetStats(uint32_t nowMs);
+
+ private:
+  struct PendingEvent {
+    int64_t captureMonoUs;
+    EventRecord record;
+  };
+
+  struct RollupQueue {
+    RollupBucket* slots;
+    int capacity;
+    int count;
+  };
+
+  int request(const char* method, const char* path, bool deviceScoped,
+              const char* body, size_t length, char* response, size_t responseSize);
+  void recordLatency(uint32_t elapsedMs, bool cold);
+  bool sendHistory();
+  bool seedRollups();
+  bool sendRollups();
+
+  UploadConfig config_;
+  TelemetryTransport& transport_;
+  TelemetryWriter& writer_;
+  Timebase& timebase_;
+  UploadClockFn clock_;
+  char prefix_[48] = "";
+  char path_[192];             // Room for a device prefix and a range query
+
+  HistorySample history_[UPLOAD_HISTORY_MAX];
+  int historyCount_ = 0;
+  PendingEvent events_[UPLOAD_EVENT_MAX];
+  int eventCount_ = 0;
+  int64_t lastEventEpochUs_ = 0;    // Event keys never collide
+  RollupBucket minuteRollups_[UPLOAD_MINUTE_ROLLUP_MAX];
+  RollupBucket hourRollups_[UPLOAD_HOUR_ROLLUP_MAX];
+  RollupBucket dayRollups_[UPLOAD_DAY_ROLLUP_MAX];
+  RollupQueue rollups_[ROLLUP_LEVELS];
+  RollupAggregator* aggregator_ = nullptr;
+  bool rollupSeeded_[ROLLUP_LEVELS] = {};
+  char response_[384];         // One rollup node read back
+
+  int lastStatus_ = 0;
+  uint8_t lastFailedSteps_ = 0;
+  int consecutiveFailures_ = 0;
+  uint32_t backoffMs_ = 0;
+  uint32_t backoffStartMs_ = 0;
+  UploadStats stats_ = {};
+};
@@ -0,0 +1,112 @@
+#include "Timebase.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Timebase::Timebase(const TimebaseConfig& config, MonotonicClockFn monotonic, ReferenceClockFn reference)
+    : config_(config), monotonic_(monotonic), reference_(reference) {}
+
+void Timebase::setClockSources(MonotonicClockFn monotonic, ReferenceClockFn reference) {
+  monotonic_ = monotonic;
+  reference_ = reference;
+  synced_ = false;
+  offsetUs_ = 0;
+  slewRemainingUs_ = 0;
+  slewCarry_ = 0;
+  lastSlewMonoUs_ = 0;
+  polled_ = false;
+  lastEpochUs_ = 0;
+  lastStepUs_ = 0;
+}
+
+int64_t Timebase::nowEpochUs() {
+  int64_t now = epochUsAt(monotonic_());
+  if (now <= lastEpochUs_) now = lastEpochUs_ + 1;
+  lastEpochUs_ = now;
+  return now;
+}
+
+// Applies pending correction at no more than slewMaxPpm. The budget is kept
+// in us * 1e6 so frequent calls (less than 1us of budget each) still add up.
+void Timebase::applySlew(int64_t mono) {
+  if (slewRemainingUs_ != 0) {
+    slewCarry_ += (mono - lastSlewMonoUs_) * config_.slewMaxPpm;
+    int64_t budget = slewCarry_ / 1000000LL;
+    slewCarry_ -= budget * 1000000LL;
+    int64_t step = slewRemainingUs_ > 0 ? (budget < slewRemainingUs_ ? budget : slewRemainingUs_)
+                                        : (-budget > slewRemainingUs_ ? -budget : slewRemainingUs_);
+    offsetUs_ += step;
+    slewRemainingUs_ -= step;
+    if (slewRemainingUs_ == 0) slewCarry_ = 0;
+  }
+  lastSlewMonoUs_ = mono;
+}
+
+TimebaseEvent Timebase::service() {
+  int64_t mono = monotonic_();
+  applySlew(mono);
+
+  int64_t intervalUs = (int64_t)(synced_ ? config_.disciplineMs : config_.syncPollMs) * 1000LL;
+  if (polled_ && mono - lastPollMonoUs_ < intervalUs) return TIMEBASE_IDLE;
+  polled_ = true;
+  lastPollMonoUs_ = mono;
+
+  int64_t reference;
+  if (!reference_(&reference)) return TIMEBASE_IDLE;
+
+  int64_t error = reference - (mono + offsetUs_);
+  int64_t magnitude = error < 0 ? -error : error;
+  if (!synced_ || magnitude > config_.stepThresholdUs) {
+    offsetUs_ += error;
+    slewRemainingUs_ = 0;
+    slewCarry_ = 0;
+    lastStepUs_ = error;
+    if (!synced_) {
+      synced_ = true;
+      return TIMEBASE_SYNCED;
+    }
+    return TIMEBASE_STEPPED;
+  }
+  slewRemainingUs_ = error;
+  return TIMEBASE_SLEWING;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static int64_t daysFromCivil(int year, int month, int day) {
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t yearOfEra = year - era * 400;
+  int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+bool parseHttpDate(const char* text, int64_t* epochSeconds) {
+  static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char monthName[4];
+  int day, year, hour, minute, second, end = 0;
+  if (!text || sscanf(text, "%*3s, %d %3s %d %d:%d:%d GMT%n", &day, monthName, &year,
+                      &hour, &minute, &second, &end) != 6 || end == 0) {
+    return false;
+  }
+  const char* found = strstr(MONTHS, monthName);
+  if (!found || strlen(monthName) != 3 || (found - MONTHS) % 3 != 0) return false;
+  int month = (found - MONTHS) / 3 + 1;
+  if (day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+  *epochSeconds = daysFromCivil(year, month, day) * 86400LL + hour * 3600 + minute * 60 + second;
+  return true;
+}
+
+void HttpDateClock::record(const char* dateHeader, int64_t monoUs) {
+  int64_t seconds;
+  if (!parseHttpDate(dateHeader, &seconds)) return;
+  epochUs_ = seconds * 1000000LL + 500000;
+  monoUs_ = monoUs;
+  valid_ = true;
+}
+
+bool HttpDateClock::epochUsAt(int64_t monoUs, int64_t* epochUs) const {
+  if (!valid_) return false;
+  *epochUs = epochUs_ + (monoUs - monoUs_);
+  return true;
+}
@@ -0,0 +1,89 @@
+// Epoch time = monotonic microseconds + reference-disciplined offset.
+// Corrections are slewed so timestamps never jump; only the first sync and
+// errors above the step threshold step the offset. Both clocks are injected,
+// so the discipline runs unchanged against fake clocks on the host.
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+typedef int64_t (*MonotonicClockFn)();              // Microseconds, never goes backwards
+typedef bool (*ReferenceClockFn)(int64_t* epochUs);  // False until the reference is valid
+
+struct TimebaseConfig {
+  uint32_t syncPollMs;        // Reference poll period until first sync
+  uint32_t disciplineMs;      // Reference poll period once synced
+  int64_t stepThresholdUs;    // Larger errors are stepped, not slewed
+  int64_t slewMaxPpm;         // Max slew rate (us of correction per second)
+};
+
+// Result of one service() call, for logging
+enum TimebaseEvent {
+  TIMEBASE_IDLE,
+  TIMEBASE_SYNCED,            // First reference accepted, offset stepped
+  TIMEBASE_STEPPED,           // Error above threshold, offset stepped (see lastStepUs())
+  TIMEBASE_SLEWING            // New correction queued for slewing
+};
+
+class Timebase {
+ public:
+  Timebase(const TimebaseConfig& config, MonotonicClockFn monotonic, ReferenceClockFn reference);
+
+  // Swaps clock sources and forgets the sync state
+  void setClockSources(MonotonicClockFn monotonic, ReferenceClockFn reference);
+
+  // Applies the pending slew and polls the reference when due. The poll
+  // schedule runs on the monotonic clock. Cheap enough to call every loop.
+  TimebaseEvent service();
+
+  int64_t monotonicUs() const { return monotonic_(); }
+  bool synced() const { return synced_; }
+
+  // Epoch microseconds for a monotonic capture time (valid once synced)
+  int64_t epochUsAt(int64_t monoUs) const { return monoUs + offsetUs_; }
+
+  // Strictly increasing epoch microseconds, so consecutive calls never collide
+  int64_t nowEpochUs();
+  time_t nowEpochSeconds() const { return (time_t)(epochUsAt(monotonic_()) / 1000000LL); }
+
+  int64_t offsetUs() const { return offsetUs_; }
+  int64_t slewRemainingUs() const { return slewRemainingUs_; }
+  int64_t lastStepUs() const { return lastStepUs_; }
+
+ private:
+  void applySlew(int64_t mono);
+
+  TimebaseConfig config_;
+  MonotonicClockFn monotonic_;
+  ReferenceClockFn reference_;
+
+  bool synced_ = false;
+  int64_t offsetUs_ = 0;          // Epoch us = monotonic us + offset
+  int64_t slewRemainingUs_ = 0;   // Correction not yet applied
+  int64_t slewCarry_ = 0;         // Sub-microsecond budget carried between calls (us * 1e6)
+  int64_t lastSlewMonoUs_ = 0;
+  int64_t lastPollMonoUs_ = 0;
+  bool polled_ = false;
+  int64_t lastEpochUs_ = 0;       // Last value returned by nowEpochUs()
+  int64_t lastStepUs_ = 0;
+};
+
+// Parses an HTTP Date header ("Sun, 06 Nov 1994 08:49:37 GMT") to epoch seconds
+bool parseHttpDate(const char* text, int64_t* epochSeconds);
+
+// Fallback reference from the Date header of server responses, for networks
+// without NTP (e.g. a local RTDB stand-in). The header has 1s resolution, so
+// the estimate is centred on the second it names.
+class HttpDateClock {
+ public:
+  // Call with the Date header of a response and the monotonic time it arrived
+  void record(const char* dateHeader, int64_t monoUs);
+
+  bool valid() const { return valid_; }
+  bool epochUsAt(int64_t monoUs, int64_t* epochUs) const;
+
+ private:
+  bool valid_ = false;
+  int64_t epochUs_ = 0;
+  int64_t monoUs_ = 0;
+};
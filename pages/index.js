@@ -1,4 +1,4 @@
-import { useState, useEffect } from 'react';
+import { useState, useEffect, useRef } from 'react';
 import Head from 'next/head';
 import dynamic from 'next/dynamic';
 
@@ -28,7 +28,8 @@ export default function Home() {
     timestamp: '--',
     circuitOff: false,
     isZeroCurrent: false,
-    zeroCurrentShortCircuit: false
+    zeroCurrentShortCircuit: false,
+    cutoffState: 'ARMED'
   });
   
   const [connectionStatus, setConnectionStatus] = useState('Initializing...');
@@ -47,6 +48,12 @@ export default function Home() {
   const [shortCircuitLogs, setShortCircuitLogs] = useState([]);
   const [showCharts, setShowCharts] = useState(true);
   const [showLogs, setShowLogs] = useState(false);
+  const databaseRef = useRef(null);
+  const [fleet, setFleet] = useState({});
+  const [selectedDevice, setSelectedDevice] = useState(null);
+  const [historyRange, setHistoryRange] = useState('24h');
+  const [historyData, setHistoryData] = useState({ labels: [], min: [], mean: [], max: [], energy: 0, faults: 0 });
+  const [historyReadInfo, setHistoryReadInfo] = useState('');
 
   // Register Chart.js components
   useEffect(() => {
@@ -102,23 +109,67 @@ export default function Home() {
     });
   };
 
-  // Firebase connection
+  // Firebase connection + fleet overview (one small summary node per device)
   useEffect(() => {
-    let database;
-    
     const initFirebase = async () => {
       try {
         const { initializeApp } = await import('firebase/app');
         const { getDatabase, ref, onValue } = await import('firebase/database');
         
         const app = initializeApp(firebaseConfig);
-        database = getDatabase(app);
+        databaseRef.current = getDatabase(app);
         
-        console.log('🔥 Setting up Firebase listener for /latest path...');
+        console.log('🔥 Setting up Firebase listener for /fleet path...');
         setConnectionStatus('Connecting to Firebase...');
         
-        const dataRef = ref(database, 'latest');
-        onValue(dataRef, (snapshot) => {
+        onValue(ref(databaseRef.current, 'fleet'), (snapshot) => {
+          const devices = snapshot.val() || {};
+          setFleet(devices);
+          // Default to ?device=<id>, else the first device in the fleet
+          setSelectedDevice((current) => {
+            if (current) return current;
+            const requested = new URLSearchParams(window.location.search).get('device');
+            return requested || Object.keys(devices).sort()[0] || null;
+          });
+          if (!snapshot.exists()) {
+            console.log('🔥 No devices found at /fleet - waiting for ESP32...');
+            setConnectionStatus('Waiting for ESP32 Data');
+          }
+        }, (error) => {
+          console.error('🔥 Firebase error:', error);
+          setConnectionStatus(`Firebase Error: ${error.message}`);
+          setIsConnected(false);
+        });
+      } catch (error) {
+        console.error('🔥 Firebase initialization error:', error);
+        setConnectionStatus(`Firebase Init Failed: ${error.message}`);
+        setIsConnected(false);
+      }
+    };
+
+    initFirebase();
+  }, []);
+
+  // Live data for the selected device
+  useEffect(() => {
+    if (!databaseRef.current || !selectedDevice) return;
+    const unsubscribers = [];
+    let cancelled = false;
+    
+    setChartData({ labels: [], voltage: [], current: [], power: [], shortCircuitEvents: [] });
+    setShortCircuitLogs([]);
+    
+    const subscribe = async () => {
+      try {
+        const { ref, onValue, query, orderByKey, limitToLast } = await import('firebase/database');
+        if (cancelled) return;
+        const database = databaseRef.current;
+        const devicePath = `devices/${selectedDevice}`;
+        
+        console.log(`🔥 Setting up Firebase listener for /${devicePath}/latest path...`);
+        
+        const dataRef = ref(database, `${devicePath}/latest`);
+        unsubscribers.push(onValue(dataRef, (snapshot) => {
           console.log('🔥 Firebase snapshot received:', snapshot.exists());
           
           if (snapshot.exists()) {
@@ -147,7 +198,8 @@ export default function Home() {
               timestamp: data.timestamp || '--',
               circuitOff: circuitOff,
               isZeroCurrent: isZeroCurrent,
-              zeroCurrentShortCircuit: zeroCurrentShortCircuit
+              zeroCurrentShortCircuit: zeroCurrentShortCircuit,
+              cutoffState: data.cutoffState || 'ARMED'
             };
             
             setSensorData(newSensorData);
@@ -180,7 +232,7 @@ export default function Home() {
               }
             }
           } else {
-            console.log('🔥 No data found at /latest - waiting for ESP32...');
+            console.log(`🔥 No data found at /${devicePath}/latest - waiting for ESP32...`);
             setConnectionStatus('Waiting for ESP32 Data');
             setIsConnected(false);
             setSensorData({
@@ -195,34 +247,88 @@ export default function Home() {
           console.error('🔥 Firebase error:', error);
           setConnectionStatus(`Firebase Error: ${error.message}`);
           setIsConnected(false);
-        });
+        }));
         
-        // Listen for short circuit events
-        const eventsRef = ref(database, 'short_circuit_events');
-        onValue(eventsRef, (snapshot) => {
+        // Listen for the most recent short circuit events only (bounded read)
+        const eventsRef = query(ref(database, `${devicePath}/short_circuit_events`), orderByKey(), limitToLast(20));
+        unsubscribers.push(onValue(eventsRef, (snapshot) => {
           if (snapshot.exists()) {
             const events = [];
             snapshot.forEach((childSnapshot) => {
               const event = childSnapshot.val();
+              // timestampUs (epoch microseconds) is present on newer records
+              const timeMs = event.timestampUs ? event.timestampUs / 1000 : parseInt(event.timestamp) * 1000;
               events.push({
                 id: childSnapshot.key,
                 ...event,
-                date: new Date(parseInt(event.timestamp) * 1000).toLocaleString()
+                timeMs,
+                date: new Date(timeMs).toLocaleString()
               });
             });
-            setShortCircuitLogs(events.sort((a, b) => b.timestamp - a.timestamp));
+            setShortCircuitLogs(events.sort((a, b) => b.timeMs - a.timeMs));
           }
-        });
+        }));
         
       } catch (error) {
-        console.error('🔥 Firebase initialization error:', error);
-        setConnectionStatus(`Firebase Init Failed: ${error.message}`);
+        console.error('🔥 Firebase subscription error:', error);
+        setConnectionStatus(`Firebase Error: ${error.message}`);
         setIsConnected(false);
       }
     };
 
-    initFirebase();
-  }, []);
+    subscribe();
+    return () => {
+      cancelled = true;
+      unsubscribers.forEach((unsubscribe) => unsubscribe());
+    };
+  }, [selectedDevice]);
+
+  // History ranges read from device-maintained rollups, so every range
+  // costs a bounded number of nodes regardless of how much raw data exists
+  const HISTORY_RANGES = {
+    '1h':  { seconds: 3600,      level: 'minute' },  // <= 60 nodes
+    '24h': { seconds: 86400,     level: 'hour' },    // <= 24 nodes
+    '7d':  { seconds: 7 * 86400, level: 'hour' },    // <= 168 nodes
+    '30d': { seconds: 30 * 86400, level: 'day' }     // <= 30 nodes
+  };
+
+  useEffect(() => {
+    const loadHistory = async () => {
+      if (!databaseRef.current || !isConnected || !selectedDevice) return;
+      const { ref, get, query, orderByKey, startAt } = await import('firebase/database');
+      const range = HISTORY_RANGES[historyRange];
+      const start = Math.floor(Date.now() / 1000) - range.seconds;
+
+      const snapshot = await get(query(ref(databaseRef.current, `devices/${selectedDevice}/rollups/${range.level}`),
+                                       orderByKey(), startAt(String(start))));
+      const labels = [], min = [], mean = [], max = [];
+      let energy = 0, faults = 0, nodes = 0;
+      snapshot.forEach((child) => {
+        const bucket = child.val();
+        const date = new Date(parseInt(child.key) * 1000);
+        labels.push(range.level === 'day' ? date.toLocaleDateString() : date.toLocaleString());
+        min.push(bucket.pMin);
+        mean.push(bucket.pMean);
+        max.push(bucket.pMax);
+        energy += bucket.energyWh || 0;
+        faults += bucket.faults || 0;
+        nodes++;
+      });
+      const bytes = snapshot.exists() ? JSON.stringify(snapshot.val()).length : 0;
+      console.log(`📊 History ${historyRange}: ${nodes} ${range.level} nodes, ${bytes} bytes`);
+      setHistoryReadInfo(`${nodes} ${range.level} buckets, ${(bytes / 1024).toFixed(1)} KB read`);
+      setHistoryData({ labels, min, mean, max, energy, faults });
+    };
+    loadHistory().catch((error) => console.error('📊 History load failed:', error));
+  }, [historyRange, isConnected, selectedDevice]);
+
+  // Ask the ESP32 to re-close the load after a trip/lockout
+  const requestCutoffReset = async () => {
+    if (!databaseRef.current || !selectedDevice) return;
+    const { ref, set } = await import('firebase/database');
+    await set(ref(databaseRef.current, `devices/${selectedDevice}/control/cutoffReset`), true);
+    console.log('🔄 Load cutoff reset requested');
+  };
 
   const formatTimestamp = (timestamp) => {
     if (timestamp === '--') return 'Waiting for data...';
@@ -293,6 +399,25 @@ export default function Home() {
           </div>
         )}
 
+        {/* Fleet Overview */}
+        {Object.keys(fleet).length > 1 && (
+          <div className="chart-container">
+            <h3><i className="fas fa-network-wired"></i> Fleet ({Object.keys(fleet).length} devices)</h3>
+            <div className="nav-tabs" style={{flexWrap: 'wrap'}}>
+              {Object.entries(fleet).sort(([a], [b]) => a.localeCompare(b)).map(([id, summary]) => (
+                <button
+                  key={id}
+                  className={`tab ${id === selectedDevice ? 'active' : ''}`}
+                  onClick={() => setSelectedDevice(id)}
+                  title={summary.lastSeen ? `Last seen ${new Date(summary.lastSeen * 1000).toLocaleString()}` : ''}
+                >
+                  {summary.status === 'OK' ? '✅' : '🚨'} {id} • {parseFloat(summary.power || 0).toFixed(1)}W
+                </button>
+              ))}
+            </div>
+          </div>
+        )}
+
         <div className="loading" style={{display: sensorData.voltage === '--' ? 'flex' : 'none'}}>
           <div className="spinner"></div>
           <span>Loading sensor data...</span>
@@ -333,6 +458,12 @@ export default function Home() {
             >
               <i className="fas fa-chart-line"></i> Real-time Graphs
             </button>
+            <button 
+              className={`tab ${!showCharts && !showLogs ? 'active' : ''}`}
+              onClick={() => {setShowCharts(false); setShowLogs(false);}}
+            >
+              <i className="fas fa-history"></i> History
+            </button>
             <button 
               className={`tab ${showLogs ? 'active' : ''}`}
               onClick={() => {setShowCharts(false); setShowLogs(true);}}
@@ -437,6 +568,62 @@ export default function Home() {
           </>
         )}
 
+        {/* History (rollups) */}
+        {!showCharts && !showLogs && sensorData.voltage !== '--' && (
+          <div className="chart-container">
+            <h3><i className="fas fa-history" style={{color: '#a8edea'}}></i> Power History</h3>
+            <div className="nav-tabs">
+              {Object.keys(HISTORY_RANGES).map((range) => (
+                <button
+                  key={range}
+                  className={`tab ${historyRange === range ? 'active' : ''}`}
+                  onClick={() => setHistoryRange(range)}
+                >
+                  {range}
+                </button>
+              ))}
+            </div>
+            <p style={{opacity: 0.8}}>
+              Energy: {historyData.energy.toFixed(2)} Wh • Faults: {historyData.faults} • {historyReadInfo}
+            </p>
+            <div className="chart-wrapper">
+              <Line
+                data={{
+                  labels: historyData.labels,
+                  datasets: [
+                    {
+                      label: 'Max (W)',
+                      data: historyData.max,
+                      borderColor: '#ff4757',
+                      borderWidth: 1,
+                      fill: false,
+                      tension: 0.4
+                    },
+                    {
+                      label: 'Mean (W)',
+                      data: historyData.mean,
+                      borderColor: '#a8edea',
+                      backgroundColor: 'rgba(168, 237, 234, 0.1)',
+                      borderWidth: 3,
+                      fill: true,
+                      tension: 0.4
+                    },
+                    {
+                      label: 'Min (W)',
+                      data: historyData.min,
+                      borderColor: '#00f260',
+                      borderWidth: 1,
+                      fill: false,
+                      tension: 0.4
+                    }
+                  ]
+                }}
+                options={chartOptions}
+              />
+            </div>
+          </div>
+        )}
+
         {/* Short Circuit Log */}
         {showLogs && (
           <div className="chart-container">
@@ -460,6 +647,11 @@ export default function Home() {
                         <div className="log-metric">
                           <strong>Power:</strong> {parseFloat(event.power).toFixed(2)}W
                         </div>
+                        {event.tripLatencyUs !== undefined && (
+                          <div className="log-metric">
+                            <strong>Cutoff:</strong> {event.cutoffState} in {event.tripLatencyUs}µs
+                          </div>
+                        )}
                       </div>
                     </div>
                   ))}
@@ -497,6 +689,16 @@ export default function Home() {
                isConnected ? 'Real-time monitoring active - All systems operational' : 
                'Waiting for ESP32 connection'}
             </p>
+            <p style={{marginTop: '0.5rem', fontSize: '1.1rem'}}>
+              <strong>Load Cutoff:</strong> {sensorData.cutoffState === 'LOCKOUT' ? '🔒 LOCKOUT' :
+                                             sensorData.cutoffState === 'TRIPPED' ? '⛔ TRIPPED (auto-retry pending)' :
+                                             '✅ ARMED'}
+            </p>
+            {sensorData.cutoffState && sensorData.cutoffState !== 'ARMED' && (
+              <button className="tab active" style={{marginTop: '1rem'}} onClick={requestCutoffReset}>
+                <i className="fas fa-redo"></i> Reset Load Cutoff
+              </button>
+            )}
           </div>
         </div>
 
@@ -513,7 +715,7 @@ export default function Home() {
               </div>
               <div className="debug-row">
                 <strong>Data Source:</strong> 
-                <span>{isConnected ? '🔗 ESP32 via Firebase' : '⏳ Waiting for ESP32'}</span>
+                <span>{isConnected ? `🔗 ${selectedDevice} via Firebase` : '⏳ Waiting for ESP32'}</span>
               </div>
               <div className="debug-row">
                 <strong>Last Update:</strong> 
@@ -4,9 +4,26 @@
 #include <Adafruit_INA219.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <Firebase_ESP_Client.h>
 #include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <time.h>
+#include <sys/time.h>
+#include <esp_sleep.h>
+#include <esp_pm.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <soc/gpio_struct.h>
+#include <LoadCutoff.h>
+#include <SampleScheduler.h>
+#include <TelemetryPayloads.h>
+#include <TelemetryWriter.h>
+#include <Retention.h>
+#include <RollupAggregator.h>
+#include <UploadPipeline.h>
+#include <Timebase.h>
+#include <ArcDetect.h>
+#include <LogRing.h>
 
 // ===== CONFIGURATION =====
 // WiFi credentials (Replace with your network details)
@@ -16,6 +33,11 @@ const char* password = ""; // Empty for unencrypted WiFi
 // Firebase configuration (Replace with your Firebase project details)
 #define FIREBASE_HOST "https://smartcircuitprotection-default-rtdb.asia-southeast1.firebasedatabase.app/"
 #define FIREBASE_AUTH "6gU3AqnJ6Bf8KiTiS1dFcDfaufLHTzEN9XyI33N3" // Database secret token
+// All database traffic (telemetry, remote reset, connection tests) goes over one
+// keep-alive REST connection. Point it at a local RTDB stand-in (tools/rtdb_standin.py,
+// e.g. "http://192.168.1.50:8080/") to run offline or measure upload latency/throughput
+// under a controlled network; plain http skips TLS.
+#define REST_BASE_URL FIREBASE_HOST
 
 // Display configuration (128x64 OLED)
 #define SCREEN_WIDTH 128
@@ -35,14 +57,17 @@ enum INA219_CalibrationMode {
 };
 INA219_CalibrationMode calibrationMode = CAL_32V_2A;
 
-// Firebase objects
-FirebaseData fbdo;
-FirebaseAuth auth;
-FirebaseConfig config;
+// Device identity: every write goes under /devices/<deviceId>/
+char deviceId[20];          // "esp32-" + eFuse MAC in hex
+char devicePrefix[40];      // "devices/<deviceId>/"
 
 // ===== FUNCTION DECLARATIONS =====
-void logShortCircuitEvent();
+void logShortCircuitEvent(uint32_t tripLatencyUs);
+bool flushShortCircuitEvents();
+void resetCutoff(const char* source);
 bool testFirebaseConnection();
+void benchmarkPayload(const char* name, bool (*build)());
+bool buildSampleHistoryPayload();
 void runFirebaseTests();
 
 // ===== GLOBAL VARIABLES =====
@@ -50,18 +75,22 @@ float voltage = 0.0;
 float current = 0.0;
 float power = 0.0;
 bool shortCircuitDetected = false;
-unsigned long lastUpdate = 0;
 unsigned long lastDisplayUpdate = 0;
 bool lastUploadSuccess = false;
 unsigned long uploadCount = 0;
 bool firebaseConnected = false;
 String lastFirebaseError = "";
 unsigned long lastFirebaseAttempt = 0;
-int firebaseRetryCount = 0;
 unsigned long firebaseUploadTime = 0;
 int successfulUploads = 0;
 int failedUploads = 0;
 const unsigned long UPDATE_INTERVAL = 5000; // 5 seconds - Firebase upload
+const unsigned long UPLOAD_JITTER_MS = 1000; // Random offset within each upload slot so a fleet doesn't sync up
+const unsigned long HEARTBEAT_INTERVAL = 60000; // 1 minute - fleet summary node
+UploadPacer samplePacer(UPDATE_INTERVAL, UPLOAD_JITTER_MS);
+UploadPacer heartbeatPacer(HEARTBEAT_INTERVAL, UPLOAD_JITTER_MS);
+uint32_t paceSeed = 1;
+const unsigned long UPLOAD_BACKOFF_MAX_MS = 60000; // Cap on the pause after consecutive failed uploads
 const unsigned long DISPLAY_UPDATE_INTERVAL = 1000; // 1 second - display update
 
 // Short circuit detection thresholds (adjust based on your specific application)
@@ -69,6 +98,100 @@ const float CURRENT_THRESHOLD = 3.0; // Amperes - lower threshold for better det
 const float VOLTAGE_DROP_THRESHOLD = 8.0; // Voltage drop threshold (adjust for your circuit)
 const float POWER_THRESHOLD = 50.0; // Power threshold in Watts
 
+// ===== LOAD CUTOFF CONFIGURATION =====
+// Relay/MOSFET driver that disconnects the load on a trip.
+// Set CUTOFF_PIN to -1 to use the simulated GPIO backend (no hardware output).
+// Worst-case trip latency is only bounded with CUTOFF_FAULT_PIN: the comparator/ALERT
+// ISR disconnects within microseconds. Without it, detection runs in loop() and can
+// wait behind a blocking upload or WiFi reconnect for seconds.
+#define CUTOFF_PIN 26              // Gate/relay driver output
+#define CUTOFF_ACTIVE_HIGH true    // Output level that disconnects the load
+#define CUTOFF_FAULT_PIN -1        // Optional comparator/INA219 ALERT input for ISR trip (-1 = disabled)
+#define CUTOFF_RESET_PIN 0         // Manual reset button, active LOW (BOOT button, -1 = disabled)
+const bool CUTOFF_LATCHING = false;                 // true = every trip locks out until reset
+const int CUTOFF_MAX_RETRIES = 3;                   // Auto-retries before lockout
+const unsigned long CUTOFF_RETRY_BASE_MS = 2000;    // First retry delay, doubled on each retry
+const unsigned long CUTOFF_RETRY_MAX_MS = 60000;    // Upper bound for retry backoff
+const unsigned long CUTOFF_RETRY_CLEAR_MS = 30000;  // Healthy time after which retry count clears
+const unsigned long CUTOFF_RESET_DEBOUNCE_MS = 50;  // Reset button fires once per press after this
+
+// ===== POWER MANAGEMENT CONFIGURATION =====
+// Low-power mode for battery-backed installs: automatic light sleep between
+// timer-driven samples (WiFi stays associated via DTIM modem sleep), batched
+// uploads, OLED blanking when idle. Automatic light sleep needs an IDF build
+// with CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE; without them
+// the waits fall back to plain idle with modem sleep.
+#define LOW_POWER_MODE false
+const unsigned long SAMPLE_INTERVAL_MS = 50;             // Normal mode sample period
+const unsigned long LOW_POWER_SAMPLE_INTERVAL_MS = 100;  // Low-power sample period
+const unsigned long DETECTION_LATENCY_BUDGET_MS = 100;   // Sample period is never allowed above this
+const int LOW_POWER_CPU_MIN_MHZ = 10;                    // PM lowers the CPU clock to this when idle
+const int LOW_POWER_UPLOAD_BATCH = 6;                    // History samples per upload in low-power mode
+const unsigned long DISPLAY_BLANK_TIMEOUT_MS = 60000;    // Blank OLED after this long without activity
+
+// Approximate supply current figures (mA) used for the average draw estimate
+const PowerModel POWER_MODEL = {
+  40.0,   // CPU awake, radio idle
+  0.8,    // Light sleep
+  95.0,   // Extra draw with radio power save off
+  20.0,   // Average extra draw with DTIM modem sleep
+  12.0,   // OLED on
+  1.0     // INA219
+};
+
+// ===== ROLLUP & RETENTION CONFIGURATION =====
+// Minute/hour/day buckets are maintained on the device so the dashboard can
+// chart any range from a bounded number of nodes under /rollups (lib/Telemetry).
+const RetentionConfig RETENTION_CONFIG = {
+  7,      // Raw /sensor_data samples kept this long (days)
+  14,     // Minute buckets kept this long (days)
+  25      // Nodes deleted per prune request
+};
+const unsigned long PRUNE_INTERVAL_MS = 60000;      // One prune batch per interval
+const size_t PRUNE_RESPONSE_SIZE = 4096;            // One batch of full raw samples
+const time_t MIN_VALID_EPOCH = 1609459200;          // 2021-01-01, clock is not set before this
+
+// ===== LOGGING CONFIGURATION =====
+// Records go through a lock-free ring and are written to Serial by a
+// low-priority task (lib/LogRing). Level and category filters are compile-time
+// build_flags, see platformio.ini.
+#ifndef LOG_SYNCHRONOUS
+#define LOG_SYNCHRONOUS 0       // 1 = print from the caller (old blocking behaviour, for comparison)
+#endif
+const unsigned long LOG_RATE_WINDOW_MS = 1000;
+
+#define LOG_ERROR(cat, ...) LOG_TO(logRing, LOG_LEVEL_ERROR, cat, __VA_ARGS__)
+#define LOG_WARN(cat, ...)  LOG_TO(logRing, LOG_LEVEL_WARN, cat, __VA_ARGS__)
+#define LOG_INFO(cat, ...)  LOG_TO(logRing, LOG_LEVEL_INFO, cat, __VA_ARGS__)
+#define LOG_DEBUG(cat, ...) LOG_TO(logRing, LOG_LEVEL_DEBUG, cat, __VA_ARGS__)
+
+// ===== ARC DETECTION CONFIGURATION =====
+// Series arcs and intermittent contacts show up as broadband current noise
+// before a hard short. A high-rate current frame is captured periodically and
+// scored from its spectrum (lib/ArcDetect).
+#define ARC_DETECTION_ENABLED true
+#define INA219_ADDRESS 0x40
+const float INA219_SHUNT_OHMS = 0.1;                 // Shunt resistor on the breakout board
+const int ARC_FRAME_SIZE = 128;                      // Samples per frame (power of two, <= ARC_MAX_FRAME)
+const unsigned long ARC_CAPTURE_INTERVAL_MS = 1000;  // One frame per interval
+const ArcScoring ARC_SCORING = {
+  {0.0, 0.1, 0.25, 0.5, 1.0},                        // Band edges, fraction of Nyquist
+  0.01,                                              // AC noise below this (A) is ignored
+  0.01                                               // ...or below 1% of the load current
+};
+const float ARC_SCORE_THRESHOLD = 0.5;
+const int ARC_CONFIRM_FRAMES = 3;                    // Consecutive frames above threshold to flag
+
+// ===== TIMEBASE CONFIGURATION =====
+// Epoch time = monotonic microseconds + NTP-disciplined offset (lib/Timebase).
+// Corrections are slewed so timestamps never jump; only the first sync steps the offset.
+const TimebaseConfig TIMEBASE_CONFIG = {
+  1000,      // Reference poll period until first sync (ms)
+  60000,     // Reference poll period once synced (ms)
+  5000000,   // Larger errors are stepped, not slewed (us)
+  500        // Max slew rate (500us per second)
+};
+
 // System status
 enum SystemStatus {
   SYSTEM_STARTING,
@@ -83,6 +206,168 @@ enum SystemStatus {
 SystemStatus currentStatus = SYSTEM_STARTING;
 unsigned long statusStartTime = 0;
 
+// Load cutoff state machine (lib/LoadCutoff), GPIO backend below
+uint32_t IRAM_ATTR cutoffMicros() {
+  return micros();
+}
+
+#if CUTOFF_PIN >= 0
+void IRAM_ATTR writeCutoffPin(bool level) {
+  digitalWrite(CUTOFF_PIN, level ? HIGH : LOW);
+}
+#endif
+
+#if CUTOFF_FAULT_PIN >= 0
+bool readCutoffFault() {
+  return digitalRead(CUTOFF_FAULT_PIN) == HIGH;
+}
+#endif
+
+const CutoffConfig CUTOFF_CONFIG = {
+  CUTOFF_ACTIVE_HIGH, CUTOFF_LATCHING, CUTOFF_MAX_RETRIES, CUTOFF_RETRY_BASE_MS,
+  CUTOFF_RETRY_MAX_MS, CUTOFF_RETRY_CLEAR_MS, CUTOFF_RESET_DEBOUNCE_MS
+};
+LoadCutoff cutoff(CUTOFF_CONFIG, cutoffMicros,
+#if CUTOFF_PIN >= 0
+                  writeCutoffPin,
+#else
+                  nullptr,         // Simulated backend: level is only recorded
+#endif
+#if CUTOFF_FAULT_PIN >= 0
+                  readCutoffFault
+#else
+                  nullptr
+#endif
+                  );
+
+// Arc detection state
+float arcCaptureBuffer[ARC_MAX_FRAME];
+ArcAnalyzer arcAnalyzer(ARC_SCORING);
+ArcFeatures lastArcFeatures = {};
+float arcSampleRateHz = 0;                // Measured rate of the last captured frame
+int arcConfirmCount = 0;
+bool arcFaultDetected = false;
+unsigned long lastArcCapture = 0;
+
+// Timebase state
+int64_t lastSampleMonoUs = 0;         // Capture time of the latest sensor sample
+
+
+// Power management state
+SampleScheduler sampleScheduler(LOW_POWER_MODE ? LOW_POWER_SAMPLE_INTERVAL_MS : SAMPLE_INTERVAL_MS,
+                                DETECTION_LATENCY_BUDGET_MS);
+TaskHandle_t loopTaskHandle = nullptr;  // Woken early by the fault ISR
+bool autoLightSleep = false;
+unsigned long long powerStatsStartUs = 0;
+bool displayBlanked = false;
+unsigned long lastActivityTime = 0;
+
+RollupAggregator rollups;
+unsigned long lastPruneTime = 0;
+
+// Logging state: single producer (loop task), single consumer (drain task)
+uint32_t logMillis() { return millis(); }
+LogRing logRing(logMillis, LOG_RATE_WINDOW_MS);
+TaskHandle_t logDrainHandle = nullptr;
+
+// Loop timing (work only, excluding the wait for the next sample)
+unsigned long loopWorkMaxUs = 0;
+unsigned long long loopWorkTotalUs = 0;
+unsigned long loopWorkCount = 0;
+
+// ===== LOGGING FUNCTIONS =====
+void notifyLogDrain() {
+  if (logDrainHandle) xTaskNotifyGive(logDrainHandle);
+}
+
+void writeSerialLine(const char* line, size_t length) {
+  Serial.write((const uint8_t*)line, length);
+}
+
+// Only task that writes log records to the UART; blocking here never stalls loop().
+// Sleeps until a record is queued, so it does not keep the CPU out of light sleep.
+void logDrainTask(void*) {
+  LogRecord record;
+  char line[LOG_LINE_MAX];
+  uint32_t reportedDrops = 0;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (logRing.pop(record)) {
+      writeSerialLine(line, logFormatLine(record, line, sizeof(line)));
+    }
+    if (logRing.dropped() != reportedDrops) {
+      Serial.printf("[log] %lu records dropped (ring full)\n", (unsigned long)(logRing.dropped() - reportedDrops));
+      reportedDrops = logRing.dropped();
+    }
+  }
+}
+
+void initLogging() {
+#if LOG_SYNCHRONOUS
+  logRing.setSynchronousSink(writeSerialLine);
+#else
+  logRing.setNotify(notifyLogDrain);
+  // Core 0 at low priority, away from loop() on the Arduino core
+  xTaskCreatePinnedToCore(logDrainTask, "logDrain", 3072, nullptr, 1, &logDrainHandle, 0);
+#endif
+}
+
+// ===== TIMEBASE FUNCTIONS =====
+int64_t espMonotonicUs() {
+  return esp_timer_get_time();
+}
+
+// System clock, set in the background by SNTP
+bool sntpReferenceUs(int64_t* epochUs) {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < MIN_VALID_EPOCH) return false;
+  *epochUs = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+  return true;
+}
+
+// Date headers of REST responses, used until SNTP sets the clock (e.g. on a
+// LAN with a local RTDB stand-in and no NTP server)
+HttpDateClock httpDateClock;
+
+bool referenceUs(int64_t* epochUs) {
+  return sntpReferenceUs(epochUs) || httpDateClock.epochUsAt(esp_timer_get_time(), epochUs);
+}
+
+Timebase timebase(TIMEBASE_CONFIG, espMonotonicUs, referenceUs);
+
+// Disciplines the timebase to NTP. Cheap enough to run every loop.
+void serviceTimebase() {
+  switch (timebase.service()) {
+    case TIMEBASE_SYNCED: {
+      time_t nowSecs = timebase.nowEpochSeconds();
+      struct tm timeinfo;
+      gmtime_r(&nowSecs, &timeinfo);
+      char synced[32];
+      strftime(synced, sizeof(synced), "%Y-%m-%d %H:%M:%S UTC", &timeinfo);
+      LOG_INFO(SYSTEM, "🕒 Time synced: %s", synced);
+      break;
+    }
+    case TIMEBASE_STEPPED:
+      LOG_WARN(SYSTEM, "🕒 Time stepped by %ldms", (long)(timebase.lastStepUs() / 1000));
+      break;
+    default:
+      break;
+  }
+}
+
+// ===== DEVICE IDENTITY =====
+void initDeviceIdentity() {
+  uint64_t mac = ESP.getEfuseMac();
+  snprintf(deviceId, sizeof(deviceId), "esp32-%012llx", (unsigned long long)mac);
+  snprintf(devicePrefix, sizeof(devicePrefix), "devices/%s/", deviceId);
+  
+  // Start each board at its own phase of the upload/heartbeat cycles
+  paceSeed = esp_random() ^ (uint32_t)(mac >> 16);
+  
+  Serial.print("Device ID: "); Serial.println(deviceId);
+}
+
 // ===== DISPLAY FUNCTIONS =====
 void initDisplay() {
   if(!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
@@ -146,7 +431,17 @@ void updateDisplay(String status, String message = "") {
       display.print(F("ERR"));
     }
     
-    if (shortCircuitDetected) {
+    if (cutoff.state() == CUTOFF_LOCKOUT) {
+      display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
+      display.setCursor(70, 50);
+      display.println(F("LOCKOUT"));
+      display.setTextColor(SSD1306_WHITE);
+    } else if (cutoff.state() == CUTOFF_TRIPPED) {
+      display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
+      display.setCursor(70, 50);
+      display.println(F("CUTOFF"));
+      display.setTextColor(SSD1306_WHITE);
+    } else if (shortCircuitDetected) {
       display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
       display.setCursor(70, 50);
       display.println(F("SHORT!"));
@@ -185,6 +480,173 @@ bool connectToWiFi() {
   }
 }
 
+// ===== LOAD CUTOFF FUNCTIONS =====
+#if CUTOFF_FAULT_PIN >= 0
+void IRAM_ATTR onCutoffFaultISR() {
+  cutoff.trip(micros());
+#if LOW_POWER_MODE
+  // Level-triggered so it can wake light sleep: mask until the load re-closes
+  gpio_ll_intr_disable(&GPIO, (gpio_num_t)CUTOFF_FAULT_PIN);
+#endif
+  if (loopTaskHandle) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+#endif
+
+// Unmasks the level-triggered fault input after the load re-closed
+void rearmFaultInput() {
+#if CUTOFF_FAULT_PIN >= 0 && LOW_POWER_MODE
+  gpio_intr_enable((gpio_num_t)CUTOFF_FAULT_PIN);
+#endif
+}
+
+void initCutoff() {
+#if CUTOFF_PIN >= 0
+  pinMode(CUTOFF_PIN, OUTPUT);
+#else
+  Serial.println("Load cutoff: simulated GPIO backend");
+#endif
+  cutoff.begin();
+
+#if CUTOFF_RESET_PIN >= 0
+  pinMode(CUTOFF_RESET_PIN, INPUT_PULLUP);
+#endif
+
+#if CUTOFF_FAULT_PIN >= 0
+  pinMode(CUTOFF_FAULT_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(CUTOFF_FAULT_PIN), onCutoffFaultISR, RISING);
+#if LOW_POWER_MODE
+  // Only level interrupts wake the CPU from light sleep
+  gpio_wakeup_enable((gpio_num_t)CUTOFF_FAULT_PIN, GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+#endif
+  Serial.println("Load cutoff: hardware fault input armed");
+#else
+  Serial.println("Load cutoff: no fault input, trip latency follows loop() timing");
+#endif
+}
+
+void resetCutoff(const char* source) {
+  if (cutoff.reset(millis())) {
+    rearmFaultInput();
+    LOG_INFO(SYSTEM, "🔄 Load cutoff reset (%s)", source);
+  }
+}
+
+// Runs from loop(): retry/backoff scheduling, lockout, manual reset and one
+// event record per trip
+void serviceCutoff() {
+  bool buttonDown = false;
+#if CUTOFF_RESET_PIN >= 0
+  buttonDown = digitalRead(CUTOFF_RESET_PIN) == LOW;
+#endif
+  uint8_t events = cutoff.service(millis(), buttonDown);
+
+  if (events & CUTOFF_EVENT_TRIPPED) {
+    LOG_WARN(SYSTEM, "⛔ Load disconnected, latency: %luus", (unsigned long)cutoff.lastTripLatencyUs());
+    logShortCircuitEvent(cutoff.lastTripLatencyUs());
+  }
+  if (events & CUTOFF_EVENT_LOCKOUT) {
+    LOG_ERROR(SYSTEM, "🔒 Load cutoff LOCKOUT - manual or remote reset required");
+  }
+  if (events & CUTOFF_EVENT_RETRY_SCHEDULED) {
+    LOG_INFO(SYSTEM, "Auto-retry %d/%d in %lums", cutoff.retryCount(), CUTOFF_MAX_RETRIES,
+             (unsigned long)cutoff.retryBackoffMs());
+  }
+  if (events & CUTOFF_EVENT_RESET) {
+    LOG_INFO(SYSTEM, "🔄 Load cutoff reset (button)");
+  }
+  if (events & CUTOFF_EVENT_RECLOSED) {
+    LOG_INFO(SYSTEM, "🔌 Auto-retry: re-closing load");
+  }
+  if (events & (CUTOFF_EVENT_RESET | CUTOFF_EVENT_RECLOSED)) {
+    rearmFaultInput();
+  }
+}
+
+// ===== POWER MANAGEMENT FUNCTIONS =====
+int uploadBatchSize() {
+  return LOW_POWER_MODE ? LOW_POWER_UPLOAD_BATCH : 1;
+}
+
+// Estimated fraction of time awake since boot: loop work over elapsed time.
+// Other tasks (WiFi, log drain) wake the CPU too, so this is a lower bound.
+float measuredAwakeFraction() {
+  return awakeFraction(loopWorkTotalUs, esp_timer_get_time() - powerStatsStartUs);
+}
+
+void wakeDisplay() {
+  lastActivityTime = millis();
+  if (displayBlanked) {
+    display.ssd1306_command(SSD1306_DISPLAYON);
+    displayBlanked = false;
+  }
+}
+
+void blankDisplay() {
+  display.ssd1306_command(SSD1306_DISPLAYOFF);
+  displayBlanked = true;
+}
+
+// Lets the idle task enter light sleep whenever no task is runnable. Unlike
+// esp_light_sleep_start() this keeps WiFi associated: the PM lock held by the
+// WiFi driver wakes the radio for each DTIM beacon.
+bool enableAutoLightSleep() {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t pmConfig;
+  pmConfig.max_freq_mhz = getCpuFrequencyMhz();
+  pmConfig.min_freq_mhz = LOW_POWER_CPU_MIN_MHZ;
+  pmConfig.light_sleep_enable = true;
+  return esp_pm_configure(&pmConfig) == ESP_OK;
+#else
+  return false;
+#endif
+}
+
+void initPowerManagement() {
+  if (LOW_POWER_MODE) {
+    setCpuFrequencyMhz(80);
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+    autoLightSleep = enableAutoLightSleep();
+    Serial.println(autoLightSleep ? "Low-power mode: automatic light sleep + modem sleep enabled"
+                                  : "Low-power mode: modem sleep only (automatic light sleep not supported by this build)");
+  }
+
+  // Nominal sample cost of ~2ms (INA219 reads + detection) per period; only
+  // the mode actually in effect is reported
+  float lowPowerAwake = 2.0 / (float)LOW_POWER_SAMPLE_INTERVAL_MS;
+  Serial.print("Estimated average current draw (");
+  Serial.print(!LOW_POWER_MODE ? "normal mode" : autoLightSleep ? "low-power mode, light sleep" : "low-power mode, modem sleep only");
+  Serial.println("):");
+  Serial.print("   Display on: ");
+  Serial.print(estimateAverageCurrentMA(POWER_MODEL, lowPowerAwake, autoLightSleep, LOW_POWER_MODE, true), 1);
+  Serial.println(" mA");
+  Serial.print("   Display blanked: ");
+  Serial.print(estimateAverageCurrentMA(POWER_MODEL, lowPowerAwake, autoLightSleep, LOW_POWER_MODE, false), 1);
+  Serial.println(" mA");
+
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  powerStatsStartUs = esp_timer_get_time();
+  lastActivityTime = millis();
+  sampleScheduler.start(millis());
+}
+
+// Waits for the next sample slot on a fixed cadence. The loop task blocks, so
+// with automatic light sleep the CPU sleeps until the slot or until the fault
+// ISR notifies it.
+void waitForNextSample() {
+  uint32_t waitMs = sampleScheduler.next(millis());
+  if (waitMs == 0) return;
+
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs)) > 0) {
+    wakeDisplay();
+    sampleScheduler.sampleNow(millis()); // Fault input: sample right away
+  }
+}
+
 // ===== INA219 FUNCTIONS =====
 bool initINA219() {
   updateDisplay("INA219", "Initializing...");
@@ -267,6 +729,14 @@ void readSensorData() {
   static bool bufferFilled = false;
   
   float rawVoltage, rawCurrent, rawPower;
+  unsigned long sampleUs = micros(); // Detection time reference for trip latency
+  lastSampleMonoUs = timebase.monotonicUs();
+  
+  // Samples taken while the load was disconnected must not feed the average
+  if (cutoff.consumeFilterReset()) {
+    bufferIndex = 0;
+    bufferFilled = false;
+  }
   
   if (ina219Available) {
     // Read from INA219 sensor with maximum precision
@@ -278,6 +748,11 @@ void readSensorData() {
     float currentMA = ina219.getCurrent_mA();
     rawCurrent = currentMA / 1000.0; // Convert to Amperes with 3 decimal precision
     
+    // Fast trip on the raw sample, before range clamping and averaging
+    if (abs(rawCurrent) > CURRENT_THRESHOLD && !isnan(rawCurrent)) {
+      cutoff.trip(sampleUs);
+    }
+    
     // Calculate power with high precision (P = V * I)
     rawPower = rawVoltage * rawCurrent;
     
@@ -296,12 +771,12 @@ void readSensorData() {
     
     // Validate readings (check for reasonable values)
     if (rawVoltage < -1 || rawVoltage > 50 || isnan(rawVoltage)) {
-      Serial.println("Warning: Invalid voltage reading from INA219");
+      LOG_WARN(SENSOR, "Invalid voltage reading from INA219");
       rawVoltage = voltage; // Use previous value
     }
     
     if (abs(rawCurrent) > 20 || isnan(rawCurrent)) {
-      Serial.println("Warning: Invalid current reading from INA219");
+      LOG_WARN(SENSOR, "Invalid current reading from INA219");
       rawCurrent = current; // Use previous value
     }
     
@@ -356,8 +831,8 @@ void readSensorData() {
   // Check for zero current (0.000A with 3 decimal precision)
   bool isZeroCurrent = (abs(current) < 0.001); // 0.000A threshold
   
-  // Count consecutive zero current readings
-  if (isZeroCurrent && voltage > 1.0) {
+  // Count consecutive zero current readings (zero current is expected while cut off)
+  if (isZeroCurrent && voltage > 1.0 && cutoff.state() == CUTOFF_ARMED) {
     zeroCurrentCount++;
   } else {
     zeroCurrentCount = 0;
@@ -371,18 +846,20 @@ void readSensorData() {
   bool voltageDropped = (voltage < VOLTAGE_DROP_THRESHOLD && voltage > 0.5);
   bool powerSpike = (power > 50.0);
   bool zeroCurrentShortCircuit = (zeroCurrentCount >= 3 && voltage > 1.0); // 3 consecutive zero readings
+  bool arcFault = arcFaultDetected; // Confirmed arc signature from spectral analysis
   
-  shortCircuitDetected = !circuitOff && (currentOverload || voltageDropped || powerSpike || zeroCurrentShortCircuit);
+  shortCircuitDetected = !circuitOff && (currentOverload || voltageDropped || powerSpike || zeroCurrentShortCircuit || arcFault);
   
-  // Log short circuit events with debouncing
+  // Actuate before any logging so serial/cloud I/O never adds to trip latency
+  if (shortCircuitDetected) {
+    cutoff.trip(sampleUs);
+  }
+  
+  // Report the detection; the event record is written per trip by serviceCutoff()
   static unsigned long lastAlertTime = 0;
   if (shortCircuitDetected && !previousState && (millis() - lastAlertTime > 2000)) {
-    Serial.println("⚠️  SHORT CIRCUIT DETECTED!");
-    Serial.print("Voltage: "); Serial.print(voltage, 3); Serial.println("V");
-    Serial.print("Current: "); Serial.print(current, 3); Serial.println("A");
-    Serial.print("Power: "); Serial.print(power, 3); Serial.println("W");
-    Serial.print("Zero current count: "); Serial.println(zeroCurrentCount);
-    logShortCircuitEvent();
+    LOG_ERROR(SENSOR, "⚠️ SHORT CIRCUIT DETECTED! V: %.3fV, I: %.3fA, P: %.3fW, zero count: %d, arc: %.3f",
+              voltage, current, power, zeroCurrentCount, lastArcFeatures.score);
     lastAlertTime = millis();
   }
   
@@ -390,9 +867,9 @@ void readSensorData() {
   static bool previousCircuitOff = false;
   if (circuitOff != previousCircuitOff) {
     if (circuitOff) {
-      Serial.println("🔌 Circuit OFF - No power detected");
+      LOG_INFO(SENSOR, "🔌 Circuit OFF - No power detected");
     } else {
-      Serial.println("⚡ Circuit ON - Power detected");
+      LOG_INFO(SENSOR, "⚡ Circuit ON - Power detected");
     }
     previousCircuitOff = circuitOff;
   }
@@ -400,14 +877,8 @@ void readSensorData() {
   // Debug output every 5 seconds
   static unsigned long lastDebugPrint = 0;
   if (millis() - lastDebugPrint > 5000) {
-    Serial.print("Sensor Status - V: ");
-    Serial.print(voltage, 3);
-    Serial.print("V, I: ");
-    Serial.print(current, 3);
-    Serial.print("A, P: ");
-    Serial.print(power, 3);
-    Serial.print("W, Mode: ");
-    Serial.println(ina219Available ? "SENSOR" : "SIMULATED");
+    LOG_INFO(SENSOR, "Sensor Status - V: %.3fV, I: %.3fA, P: %.3fW, Mode: %s",
+              voltage, current, power, ina219Available ? "SENSOR" : "SIMULATED");
     lastDebugPrint = millis();
   }
 }
@@ -435,56 +906,430 @@ void recalibrateINA219(int mode) {
   }
 }
 
+// ===== ARC DETECTION FUNCTIONS =====
+bool ina219ReadRegister(uint8_t reg, uint16_t& value) {
+  Wire.beginTransmission(INA219_ADDRESS);
+  Wire.write(reg);
+  if (Wire.endTransmission() != 0) return false;
+  if (Wire.requestFrom((uint8_t)INA219_ADDRESS, (uint8_t)2) != 2) return false;
+  value = (Wire.read() << 8) | Wire.read();
+  return true;
+}
+
+bool ina219WriteRegister(uint8_t reg, uint16_t value) {
+  Wire.beginTransmission(INA219_ADDRESS);
+  Wire.write(reg);
+  Wire.write(value >> 8);
+  Wire.write(value & 0xFF);
+  return Wire.endTransmission() == 0;
+}
+
+// High-rate capture: the INA219 is switched to shunt-only continuous
+// conversions at 9 bits (84us) and reads are paced to the conversion period,
+// so every sample is a fresh conversion. The register pointer stays on the
+// shunt register, so each read is a bare 2 byte transfer (~70us at 400kHz).
+// The calibrated configuration is restored afterwards. Also trips on
+// over-current mid-frame. Returns false if the sensor did not respond.
+bool captureArcFrame(float* samples, int n) {
+  uint16_t savedConfig;
+  Wire.setClock(400000);
+  if (!ina219ReadRegister(INA219_REG_CONFIG, savedConfig) ||
+      !ina219WriteRegister(INA219_REG_CONFIG, ina219ArcCaptureConfig(savedConfig))) {
+    Wire.setClock(100000);
+    arcSampleRateHz = 0;
+    return false;
+  }
+  
+  // Point at the shunt register once, then wait out the first conversion
+  Wire.beginTransmission(INA219_ADDRESS);
+  Wire.write(INA219_REG_SHUNT_VOLTAGE);
+  Wire.endTransmission();
+  delayMicroseconds(INA219_CONVERSION_9BIT_US);
+  
+  bool ok = true;
+  unsigned long start = micros();
+  unsigned long nextAt = start;
+  for (int i = 0; i < n; i++) {
+    while ((long)(micros() - nextAt) < 0) {}
+    unsigned long sampleUs = micros();
+    nextAt = sampleUs + INA219_CONVERSION_9BIT_US;
+    if (Wire.requestFrom((uint8_t)INA219_ADDRESS, (uint8_t)2) != 2) {
+      ok = false;
+      break;
+    }
+    int16_t raw = (int16_t)((Wire.read() << 8) | Wire.read());
+    samples[i] = raw * INA219_SHUNT_LSB_V / INA219_SHUNT_OHMS;
+    if (fabsf(samples[i]) > CURRENT_THRESHOLD) cutoff.trip(sampleUs);
+  }
+  unsigned long elapsed = micros() - start;
+  
+  ina219WriteRegister(INA219_REG_CONFIG, savedConfig);
+  Wire.setClock(100000);
+  arcSampleRateHz = ok && elapsed > 0 ? n * 1000000.0 / elapsed : 0;
+  return ok;
+}
+
+void serviceArcDetection() {
+  if (!ARC_DETECTION_ENABLED || !ina219Available || cutoff.state() != CUTOFF_ARMED) {
+    arcConfirmCount = 0;
+    arcFaultDetected = false;
+    return;
+  }
+  if (millis() - lastArcCapture < ARC_CAPTURE_INTERVAL_MS) return;
+  lastArcCapture = millis();
+  
+  if (!captureArcFrame(arcCaptureBuffer, ARC_FRAME_SIZE)) {
+    LOG_WARN(SENSOR, "⚡ Arc capture failed (I2C)");
+    return;
+  }
+  arcAnalyzer.analyze(arcCaptureBuffer, ARC_FRAME_SIZE, lastArcFeatures);
+  
+  if (lastArcFeatures.score >= ARC_SCORE_THRESHOLD) {
+    if (arcConfirmCount < ARC_CONFIRM_FRAMES) arcConfirmCount++;
+  } else {
+    arcConfirmCount = 0;
+  }
+  bool wasArcing = arcFaultDetected;
+  arcFaultDetected = arcConfirmCount >= ARC_CONFIRM_FRAMES;
+  if (arcFaultDetected && !wasArcing) {
+    LOG_WARN(SENSOR, "⚡ Arc signature confirmed, score: %.3f @ %.0fHz", lastArcFeatures.score, arcSampleRateHz);
+  }
+}
+
+// Scores synthetic traces (must stay below/above threshold), times each frame
+// size and measures the real capture rate
+void runArcSelfTest() {
+  Serial.println("\n⚡ === ARC DETECTION SELF-TEST ===");
+  Serial.print("   FFT backend: "); Serial.println(ArcAnalyzer::backendName());
+  
+  const int n = ARC_FRAME_SIZE;
+  bool allPassed = true;
+  for (int t = 0; t < ARC_TRACE_COUNT; t++) {
+    ArcTrace trace = (ArcTrace)t;
+    arcSyntheticTrace(trace, arcCaptureBuffer, n);
+    ArcFeatures features;
+    arcAnalyzer.analyze(arcCaptureBuffer, n, features);
+    bool passed = (features.score >= ARC_SCORE_THRESHOLD) == arcTraceIsArc(trace);
+    allPassed &= passed;
+    Serial.print(passed ? "   ✅ " : "   ❌ ");
+    Serial.print(arcTraceName(trace)); Serial.print(": score ");
+    Serial.println(features.score, 3);
+  }
+  
+  for (int size = 64; size <= ARC_MAX_FRAME; size *= 2) {
+    const int runs = 20;
+    arcAnalyzer.analyze(arcCaptureBuffer, size, lastArcFeatures); // Window setup outside timing
+    unsigned long start = micros();
+    for (int r = 0; r < runs; r++) arcAnalyzer.analyze(arcCaptureBuffer, size, lastArcFeatures);
+    Serial.print("   "); Serial.print(size); Serial.print(" samples: ");
+    Serial.print((float)(micros() - start) / runs, 1); Serial.println("us/frame");
+  }
+  
+  if (ina219Available) {
+    bool captured = captureArcFrame(arcCaptureBuffer, ARC_FRAME_SIZE);
+    Serial.print("   Capture: "); Serial.print(ARC_FRAME_SIZE); Serial.print(" samples at ");
+    Serial.print(arcSampleRateHz, 0); Serial.print("Hz (conversion limit ");
+    Serial.print(1000000 / INA219_CONVERSION_9BIT_US); Serial.println(captured ? "Hz)" : "Hz), I2C error");
+  }
+  lastArcFeatures = ArcFeatures();
+  Serial.println(allPassed ? "   Arc scoring: PASS" : "   Arc scoring: FAIL");
+}
+
+void initArcDetection() {
+  if (!arcAnalyzer.begin()) {
+    Serial.println("ESP-DSP FFT init failed");
+  }
+  runArcSelfTest();
+}
+
+// ===== TELEMETRY SERIALIZATION =====
+// All payloads are serialized into one preallocated buffer. The JsonDocument
+// draws its memory from a fixed pool, so building a payload never touches the heap.
+// The wire format itself lives in lib/Telemetry (TelemetryPayloads.h).
+const size_t TELEMETRY_POOL_SIZE = 6144;
+const size_t TELEMETRY_BUFFER_SIZE = 3072;
+
+alignas(8) uint8_t telemetryPoolStorage[TELEMETRY_POOL_SIZE];
+char telemetryBuffer[TELEMETRY_BUFFER_SIZE];
+TelemetryPool telemetryPool(telemetryPoolStorage, TELEMETRY_POOL_SIZE);
+TelemetryWriter telemetryWriter(telemetryPool, telemetryBuffer, TELEMETRY_BUFFER_SIZE);
+
+JsonObject beginPayload() {
+  return telemetryWriter.begin();
+}
+
+bool finishPayload() {
+  TelemetryStatus status = telemetryWriter.finish();
+  if (status == TELEMETRY_POOL_OVERFLOW) {
+    LOG_ERROR(FIREBASE, "❌ Telemetry pool overflow");
+  } else if (status == TELEMETRY_BUFFER_OVERFLOW) {
+    LOG_ERROR(FIREBASE, "❌ Telemetry buffer overflow");
+  }
+  return status == TELEMETRY_OK;
+}
+
+LatestStatus currentLatestStatus() {
+  return {voltage, current, power, shortCircuitDetected, cutoff.stateName(), lastArcFeatures.score};
+}
+
+// Compact per-device summary for the fleet overview at /fleet/<deviceId>
+bool buildHeartbeatPayload() {
+  HeartbeatStatus heartbeat = {
+    voltage, current, power,
+    cutoff.state() != CUTOFF_ARMED ? cutoff.stateName() : shortCircuitDetected ? "SHORT" : "OK",
+    timebase.synced() ? (long)timebase.nowEpochSeconds() : 0L,
+    successfulUploads, failedUploads, cutoff.tripCount(), (int)WiFi.RSSI()
+  };
+  fillHeartbeat(beginPayload(), heartbeat);
+  return finishPayload();
+}
+
+
+// ===== REST TRANSPORT =====
+// Serialized payloads go straight from telemetryBuffer to the RTDB REST API
+// over one keep-alive connection. Queues, retries, backoff and the request
+// metrics live in lib/Telemetry (UploadPipeline); this is only the HTTP layer.
+WiFiClientSecure restClient;
+WiFiClient restPlainClient;        // Used when REST_BASE_URL is plain http
+HTTPClient restHttp;
+
+Client& restTransport() {
+  static const bool useTls = strncmp(REST_BASE_URL, "https", 5) == 0;
+  if (useTls) {
+    restClient.setInsecure();
+    return restClient;
+  }
+  return restPlainClient;
+}
+
+// path is relative to the database root and may carry a query after '?'
+const char* restUrl(const char* path) {
+  static char url[384];
+  const char* query = strchr(path, '?');
+  int pathLength = query ? query - path : strlen(path);
+  snprintf(url, sizeof(url), "%s%.*s.json?auth=%s%s%s", REST_BASE_URL, pathLength, path, FIREBASE_AUTH,
+           query ? "&" : "", query ? query + 1 : "");
+  return url;
+}
+
+class EspRestTransport : public TelemetryTransport {
+ public:
+  int request(const char* method, const char* path, const char* body, size_t length,
+              char* response, size_t responseSize) override {
+    static const char* DATE_HEADER[] = {"Date"};
+    if (!headersCollected_) {
+      restHttp.collectHeaders(DATE_HEADER, 1);   // Kept across requests, allocated once
+      headersCollected_ = true;
+    }
+    restHttp.setReuse(true);
+    if (!restHttp.begin(restTransport(), restUrl(path))) {
+      lastFirebaseError = "REST begin failed";
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    if (body) restHttp.addHeader("Content-Type", "application/json");
+    int code = restHttp.sendRequest(method, (uint8_t*)body, length);
+    if (code > 0) httpDateClock.record(restHttp.header("Date").c_str(), esp_timer_get_time());
+    if (code == 200 && response) {
+      strlcpy(response, restHttp.getString().c_str(), responseSize);
+    } else if (code != 200) {
+      lastFirebaseError = code < 0 ? HTTPClient::errorToString(code) : String("HTTP ") + code;
+    }
+    restHttp.end();
+    return code;
+  }
+  
+  bool connected() override { return restTransport().connected(); }
+  void disconnect() override { restTransport().stop(); }
+  
+ private:
+  bool headersCollected_ = false;
+};
+
+#ifndef UPLOAD_SELF_BENCH
+#define UPLOAD_SELF_BENCH 0     // 1 = boot-time upload burst benchmark (20 PUTs, resets the upload stats)
+#endif
+
+const UploadConfig UPLOAD_CONFIG = {
+  UPDATE_INTERVAL,             // Sample cadence and first backoff step
+  UPLOAD_BACKOFF_MAX_MS,
+  uploadBatchSize(),           // Samples per upload
+  2                            // A reused keep-alive socket may be stale
+};
+
+uint32_t uploadMillis() { return millis(); }
+EspRestTransport restSession;
+UploadPipeline uploadPipeline(UPLOAD_CONFIG, restSession, telemetryWriter, timebase, uploadMillis);
+
+bool cloudReady() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+void reportTransportStats() {
+  const UploadStats& stats = uploadPipeline.stats();
+  unsigned long now = millis();
+  float windowSec = (now - stats.windowStartMs) / 1000.0f;
+  uint32_t warmRequests = stats.requests - stats.coldRequests;
+  LOG_INFO(FIREBASE, "📶 REST: %lu req, p50 %ums, p99 %ums, cold %lu (avg %lums), warm avg %lums",
+           (unsigned long)stats.requests, uploadLatencyPercentile(stats, 50), uploadLatencyPercentile(stats, 99),
+           (unsigned long)stats.coldRequests,
+           (unsigned long)(stats.coldRequests ? stats.coldTotalMs / stats.coldRequests : 0),
+           (unsigned long)(warmRequests ? stats.warmTotalMs / warmRequests : 0));
+  LOG_INFO(FIREBASE, "📶 REST: %.2f samples/s, %.0f B/s, %lu retries, %lu failed, lost %lu samples %lu rollups %lu events",
+           windowSec > 0 ? stats.samplesDelivered / windowSec : 0.0f,
+           windowSec > 0 ? stats.bytesSent / windowSec : 0.0f,
+           (unsigned long)stats.retries, (unsigned long)stats.failures,
+           (unsigned long)stats.samplesLost, (unsigned long)stats.rollupsLost,
+           (unsigned long)stats.eventsLost);
+  uploadPipeline.resetStats(now);
+}
+
+// ===== ROLLUP FUNCTIONS =====
+// Fold the current reading into the open minute/hour/day buckets (lib/Telemetry)
+void updateRollups() {
+  RollupBucket closed[ROLLUP_LEVELS];
+  time_t now = timebase.synced() ? timebase.nowEpochSeconds() : 0;
+  int count = rollups.add(millis(), now, voltage, current, power, shortCircuitDetected, closed);
+  for (int i = 0; i < count; i++) {
+    if (!uploadPipeline.queueRollup(closed[i])) {
+      LOG_WARN(FIREBASE, "⚠️ %s rollup queue full, dropped oldest closed bucket", ROLLUP_NAMES[closed[i].level]);
+    }
+  }
+}
+
+char pruneResponse[PRUNE_RESPONSE_SIZE];
+Retention retention(RETENTION_CONFIG, uploadPipeline, telemetryWriter, pruneResponse, PRUNE_RESPONSE_SIZE);
+
+// One small prune batch per call, alternating between raw samples and minute rollups
+void runRetention() {
+  if (!timebase.synced() || !cloudReady()) return;
+  uint32_t skipped = retention.skippedKeys();
+  int deleted = retention.service(timebase.nowEpochSeconds());
+  if (retention.skippedKeys() != skipped) {
+    LOG_WARN(FIREBASE, "⚠️ Prune: skipped %lu unexpected keys in %s",
+             (unsigned long)(retention.skippedKeys() - skipped), retention.lastPath());
+  }
+  if (deleted > 0) {
+    LOG_INFO(FIREBASE, "🧹 Pruned %d nodes from %s", deleted, retention.lastPath());
+  } else if (deleted < 0) {
+    LOG_WARN(FIREBASE, "⚠️ Prune of %s failed or not confirmed", retention.lastPath());
+  }
+}
+
 // ===== FIREBASE TEST FUNCTIONS =====
 bool testFirebaseConnection() {
   Serial.println("\n🧪 === FIREBASE CONNECTION TEST ===");
+  char body[64];
   
   // Test 1: Basic connection test
   Serial.print("📡 Test 1 - Basic Connection: ");
-  if (Firebase.ready()) {
-    Serial.println("✅ PASS - Firebase ready");
+  int code = uploadPipeline.get("/test_connection", body, sizeof(body));
+  if (code > 0) {
+    Serial.println("✅ PASS - Database reachable");
   } else {
-    Serial.println("❌ FAIL - Firebase not ready");
+    Serial.print("❌ FAIL - Database not reachable: ");
+    Serial.println(lastFirebaseError);
     return false;
   }
   
   // Test 2: Simple read test
   Serial.print("📖 Test 2 - Read Test: ");
-  if (Firebase.RTDB.getString(&fbdo, "/test_connection")) {
+  if (code == 200) {
     Serial.println("✅ PASS - Can read from database");
   } else {
     Serial.print("❌ FAIL - Cannot read: ");
-    Serial.println(fbdo.errorReason());
+    Serial.println(lastFirebaseError);
   }
   
   // Test 3: Simple write test
   Serial.print("✏️ Test 3 - Write Test: ");
-  if (Firebase.RTDB.setString(&fbdo, "/test_connection", "ESP32_Connected")) {
+  telemetryWriter.setRaw("\"ESP32_Connected\"");
+  if (uploadPipeline.send("PUT", "/test_connection")) {
     Serial.println("✅ PASS - Can write to database");
   } else {
     Serial.print("❌ FAIL - Cannot write: ");
-    Serial.println(fbdo.errorReason());
+    Serial.println(lastFirebaseError);
     return false;
   }
   
   // Test 4: Write sensor structure test
   Serial.print("📊 Test 4 - Sensor Data Structure: ");
-  FirebaseJson testJson;
-  testJson.set("voltage", 12.34);
-  testJson.set("current", 1.23);
-  testJson.set("power", 15.18);
-  testJson.set("timestamp", "test_timestamp");
+  JsonObject testJson = beginPayload();
+  fillReading(testJson, timebase.nowEpochUs(), 12.34, 1.23, 15.18);
   
-  if (Firebase.RTDB.setJSON(&fbdo, "/test_sensor_data", &testJson)) {
+  if (finishPayload() && uploadPipeline.send("PUT", "/test_sensor_data")) {
     Serial.println("✅ PASS - Can write sensor data structure");
   } else {
     Serial.print("❌ FAIL - Cannot write sensor data: ");
-    Serial.println(fbdo.errorReason());
+    Serial.println(lastFirebaseError);
+  }
+  
+  // Test 5: Serialization cost per payload (should never touch the heap)
+  Serial.println("⏱️ Test 5 - Payload Serialization:");
+  Serial.print("   REST session: 1 keep-alive ");
+  Serial.print(strncmp(REST_BASE_URL, "https", 5) == 0 ? "TLS" : "plain");
+  Serial.print(" connection, free heap ");
+  Serial.print(ESP.getFreeHeap()); Serial.println(" B");
+  benchmarkPayload("latest", []() {
+    fillLatest(beginPayload(), 1700000000000000LL, currentLatestStatus());
+    return finishPayload();
+  });
+  benchmarkPayload("event", []() {
+    EventRecord event = {12.34, 25.5, 314.67, "TRIPPED", 25, 0.5};
+    fillEvent(beginPayload(), 1700000000000000LL, event);
+    return finishPayload();
+  });
+  benchmarkPayload("history x12", buildSampleHistoryPayload);
+  
+#if UPLOAD_SELF_BENCH
+  // Test 6: Upload latency/throughput with full history batches (same request as uploadSensorData)
+  const int burstUploads = 20;
+  Serial.print("📶 Test 6 - Upload Burst ("); Serial.print(burstUploads);
+  Serial.print(" x "); Serial.print(UPLOAD_HISTORY_MAX); Serial.print(" samples to ");
+  Serial.print(REST_BASE_URL); Serial.println("):");
+  uploadPipeline.resetStats(millis());
+  unsigned long burstStart = millis();
+  int delivered = 0;
+  for (int i = 0; i < burstUploads; i++) {
+    if (buildSampleHistoryPayload() && uploadPipeline.send("PUT", "/test_upload")) {
+      delivered += UPLOAD_HISTORY_MAX;
+    }
   }
+  unsigned long burstMs = millis() - burstStart;
+  Serial.print("   "); Serial.print(delivered); Serial.print(" samples in ");
+  Serial.print(burstMs); Serial.print("ms, ");
+  Serial.print(burstMs ? delivered * 1000.0 / burstMs : 0.0, 1); Serial.println(" samples/s");
+  reportTransportStats();
+#endif
   
   return true;
 }
 
+// A full history batch of fixed readings, 5s apart
+bool buildSampleHistoryPayload() {
+  JsonObject root = beginPayload();
+  for (int i = 0; i < UPLOAD_HISTORY_MAX; i++) {
+    addHistoryEntry(root, 1700000000000000LL + i * 5000000LL, 12.345, 1.234, 15.234, false);
+  }
+  return finishPayload();
+}
+
+void benchmarkPayload(const char* name, bool (*build)()) {
+  const int runs = 100;
+  uint32_t heapBefore = ESP.getFreeHeap();
+  telemetryPool.resetPeak();
+  unsigned long start = micros();
+  bool ok = true;
+  for (int i = 0; i < runs; i++) ok &= build();
+  unsigned long elapsed = micros() - start;
+  int32_t heapDelta = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+  
+  Serial.print("   "); Serial.print(name); Serial.print(": ");
+  Serial.print(ok ? telemetryWriter.length() : 0); Serial.print(" bytes, ");
+  Serial.print((float)elapsed / runs, 1); Serial.print("us, pool peak ");
+  Serial.print(telemetryPool.peak()); Serial.print(" B, heap delta ");
+  Serial.print(heapDelta); Serial.println(" B");
+}
+
 void runFirebaseTests() {
   Serial.println("\n🔥 === COMPREHENSIVE FIREBASE TESTS ===");
   
@@ -508,13 +1353,11 @@ void runFirebaseTests() {
     // Test real-time updates
     Serial.println("\n⏱️ Testing real-time updates (5 seconds)...");
     for (int i = 1; i <= 5; i++) {
-      String testPath = "/realtime_test";
-      String testValue = "Update_";
-      testValue += String(i);
-      testValue += "_";
-      testValue += String(millis());
+      char testValue[40];
+      snprintf(testValue, sizeof(testValue), "\"Update_%d_%lu\"", i, millis());
+      telemetryWriter.setRaw(testValue);
       
-      if (Firebase.RTDB.setString(&fbdo, testPath.c_str(), testValue)) {
+      if (uploadPipeline.send("PUT", "/realtime_test")) {
         Serial.print("📤 Update ");
         Serial.print(i);
         Serial.print(": ✅ SUCCESS");
@@ -522,7 +1365,7 @@ void runFirebaseTests() {
         Serial.print("📤 Update ");
         Serial.print(i);
         Serial.print(": ❌ FAILED - ");
-        Serial.print(fbdo.errorReason());
+        Serial.print(lastFirebaseError);
       }
       Serial.println();
       delay(1000);
@@ -546,23 +1389,18 @@ bool initFirebase() {
   Serial.print("WiFi Status: "); Serial.println(WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected");
   Serial.print("Free Heap: "); Serial.println(ESP.getFreeHeap());
   
-  // Configure Firebase with detailed logging
-  config.database_url = FIREBASE_HOST;
   if (strlen(FIREBASE_AUTH) > 0) {
-    config.signer.tokens.legacy_token = FIREBASE_AUTH;
     Serial.println("Using legacy token authentication");
   } else {
     Serial.println("No authentication token provided");
   }
   
-  // Initialize Firebase
-  Firebase.begin(&config, &auth);
-  Firebase.reconnectWiFi(true);
-  
   Serial.println("Testing Firebase connection...");
   
   // Test connection with detailed error reporting
-  if (Firebase.RTDB.getString(&fbdo, "/test")) {
+  char body[64];
+  int code = uploadPipeline.get("/test", body, sizeof(body));
+  if (code == 200) {
     Serial.println("✅ Firebase connection successful!");
     firebaseConnected = true;
     updateDisplay("Cloud", "Connected!");
@@ -570,9 +1408,8 @@ bool initFirebase() {
     return true;
   } else {
     Serial.println("❌ Firebase connection failed!");
-    Serial.print("HTTP Code: "); Serial.println(fbdo.httpCode());
-    Serial.print("Error Reason: "); Serial.println(fbdo.errorReason());
-    lastFirebaseError = fbdo.errorReason();
+    Serial.print("HTTP Code: "); Serial.println(code);
+    Serial.print("Error Reason: "); Serial.println(lastFirebaseError);
     firebaseConnected = false;
     
     // Still continue for testing, but show error
@@ -582,76 +1419,48 @@ bool initFirebase() {
   }
 }
 
+// Queue a history sample; the oldest is dropped if uploads keep failing
+void recordHistorySample() {
+  uploadPipeline.queueSample({lastSampleMonoUs, voltage, current, power, shortCircuitDetected});
+}
+
 void uploadSensorData() {
   unsigned long startTime = millis();
   
-  if (!Firebase.ready()) {
-    Serial.println("⚠️ Firebase not ready, attempting reconnection...");
-    firebaseRetryCount++;
+  if (!cloudReady()) {
+    LOG_WARN(FIREBASE, "⚠️ WiFi down, upload deferred");
     lastUploadSuccess = false;
-    
-    if (firebaseRetryCount > 5) {
-      Serial.println("🔄 Too many Firebase retry attempts, reinitializing...");
-      initFirebase();
-      firebaseRetryCount = 0;
-    }
-    
     failedUploads++;
     return;
   }
   
-  // Reset retry count on successful ready state
-  firebaseRetryCount = 0;
-  
-  // Create timestamp
-  time_t now;
-  time(&now);
-  String timestamp = String(now);
-  
-  Serial.print("📤 Uploading sensor data to Firebase... ");
-  
-  // Update the latest readings for real-time display
-  bool success = true;
-  
-  if (!Firebase.RTDB.setFloat(&fbdo, "/latest/voltage", voltage)) {
-    Serial.print("❌ Failed to upload voltage: "); Serial.println(fbdo.errorReason());
-    success = false;
+  // Latest readings, queued events, the history batch and rollups (lib/Telemetry)
+  bool success = uploadPipeline.upload(currentLatestStatus(), lastSampleMonoUs);
+  uint8_t failed = uploadPipeline.lastFailedSteps();
+  if (failed & UPLOAD_STEP_LATEST) {
+    LOG_WARN(FIREBASE, "❌ Failed to upload latest readings: %s", lastFirebaseError.c_str());
   }
-  
-  if (!Firebase.RTDB.setFloat(&fbdo, "/latest/current", current)) {
-    Serial.print("❌ Failed to upload current: "); Serial.println(fbdo.errorReason());
-    success = false;
+  if (failed & UPLOAD_STEP_EVENTS) {
+    LOG_ERROR(FIREBASE, "Failed to log short circuit event, %d queued", uploadPipeline.pendingEvents());
   }
-  
-  if (!Firebase.RTDB.setFloat(&fbdo, "/latest/power", power)) {
-    Serial.print("❌ Failed to upload power: "); Serial.println(fbdo.errorReason());
-    success = false;
+  if (failed & UPLOAD_STEP_HISTORY) {
+    LOG_WARN(FIREBASE, "❌ Failed to upload historical data: %s", lastFirebaseError.c_str());
   }
-  
-  if (!Firebase.RTDB.setBool(&fbdo, "/latest/shortCircuit", shortCircuitDetected)) {
-    Serial.print("❌ Failed to upload shortCircuit: "); Serial.println(fbdo.errorReason());
-    success = false;
+  if (failed & UPLOAD_STEP_ROLLUPS) {
+    LOG_WARN(FIREBASE, "❌ Failed to upload rollups: %s", lastFirebaseError.c_str());
   }
-  
-  if (!Firebase.RTDB.setString(&fbdo, "/latest/timestamp", timestamp)) {
-    Serial.print("❌ Failed to upload timestamp: "); Serial.println(fbdo.errorReason());
-    success = false;
+  if (failed & UPLOAD_STEP_PAYLOAD) {
+    LOG_ERROR(FIREBASE, "❌ Telemetry payload did not fit the pool/buffer");
   }
   
-  // Create JSON object for historical data
-  FirebaseJson json;
-  json.set("timestamp", timestamp);
-  json.set("voltage", voltage);
-  json.set("current", current);
-  json.set("power", power);
-  json.set("shortCircuit", shortCircuitDetected);
-  
-  // Upload historical data
-  String path = "/sensor_data/";
-  path += timestamp;
-  if (!Firebase.RTDB.setJSON(&fbdo, path.c_str(), &json)) {
-    Serial.print("❌ Failed to upload historical data: "); Serial.println(fbdo.errorReason());
-    success = false;
+  // Remote reset request from the dashboard (only polled while disconnected)
+  if (cutoff.state() != CUTOFF_ARMED) {
+    char resetFlag[8];
+    if (uploadPipeline.get("/control/cutoffReset", resetFlag, sizeof(resetFlag)) == 200 && strcmp(resetFlag, "true") == 0) {
+      telemetryWriter.setRaw("false");
+      uploadPipeline.send("PUT", "/control/cutoffReset");
+      resetCutoff("remote");
+    }
   }
   
   // Calculate upload time
@@ -663,81 +1472,86 @@ void uploadSensorData() {
     uploadCount++;
     successfulUploads++;
     firebaseConnected = true;
-    Serial.print("✅ Success! Count: ");
-    Serial.print(uploadCount);
-    Serial.print(", Time: ");
-    Serial.print(firebaseUploadTime);
-    Serial.println("ms");
+    LOG_INFO(FIREBASE, "📤 Upload ✅ Count: %lu, Time: %lums", uploadCount, firebaseUploadTime);
   } else {
     failedUploads++;
     firebaseConnected = false;
-    Serial.println("❌ Upload failed!");
-    Serial.print("HTTP Code: "); Serial.println(fbdo.httpCode());
-    Serial.print("Error: "); Serial.println(fbdo.errorReason());
-    lastFirebaseError = fbdo.errorReason();
+    LOG_ERROR(FIREBASE, "📤 Upload ❌ HTTP %d: %s, retry in %lums", uploadPipeline.lastStatus(),
+              lastFirebaseError.c_str(), (unsigned long)uploadPipeline.backoffMs());
   }
   
   // Print statistics every 10 uploads
   if ((successfulUploads + failedUploads) % 10 == 0 && (successfulUploads + failedUploads) > 0) {
     float successRate = (float)successfulUploads * 100.0 / (successfulUploads + failedUploads);
-    Serial.println("\n📊 Firebase Upload Statistics:");
-    Serial.print("   Successful: "); Serial.println(successfulUploads);
-    Serial.print("   Failed: "); Serial.println(failedUploads);
-    Serial.print("   Success Rate: "); Serial.print(successRate); Serial.println("%");
-    Serial.print("   Avg Upload Time: "); Serial.print(firebaseUploadTime); Serial.println("ms");
-    Serial.println();
+    LOG_INFO(FIREBASE, "📊 Uploads: %d ok, %d failed (%.1f%%), last %lums",
+             successfulUploads, failedUploads, successRate, firebaseUploadTime);
+    LOG_INFO(SYSTEM, "📊 Cutoff trips: %lu (max latency %luus), sample overruns: %lu, est. avg current: %.1fmA",
+             (unsigned long)cutoff.tripCount(), (unsigned long)cutoff.maxTripLatencyUs(),
+             (unsigned long)sampleScheduler.overruns(),
+             estimateAverageCurrentMA(POWER_MODEL, measuredAwakeFraction(), autoLightSleep, LOW_POWER_MODE,
+                                      !displayBlanked));
+    LOG_INFO(SYSTEM, "📊 Loop work: avg %luus, max %luus; log dropped: %lu, suppressed: %lu",
+             loopWorkCount ? (unsigned long)(loopWorkTotalUs / loopWorkCount) : 0UL, loopWorkMaxUs,
+             (unsigned long)logRing.dropped(), (unsigned long)logRing.suppressed());
+    reportTransportStats();
   }
 }
 
-void logShortCircuitEvent() {
-  if (Firebase.ready()) {
-    time_t now;
-    time(&now);
-    String timestamp = String(now);
-    
-    FirebaseJson json;
-    json.set("timestamp", timestamp);
-    json.set("voltage", voltage);
-    json.set("current", current);
-    json.set("power", power);
-    json.set("severity", "HIGH");
-    
-    String eventPath = "/short_circuit_events/";
-    eventPath += timestamp;
-    if (Firebase.RTDB.setJSON(&fbdo, eventPath.c_str(), &json)) {
-      Serial.println("Short circuit event logged");
-    } else {
-      Serial.println("Failed to log short circuit event");
-    }
+void sendHeartbeat() {
+  if (!cloudReady()) return;
+  char fleetPath[40];
+  snprintf(fleetPath, sizeof(fleetPath), "/fleet/%s", deviceId);
+  if (!buildHeartbeatPayload() || !uploadPipeline.send("PUT", fleetPath, false)) {
+    LOG_WARN(FIREBASE, "❌ Failed to send heartbeat: %s", lastFirebaseError.c_str());
+  }
+}
+
+// One record per trip, with that trip's detection-to-actuation latency. The
+// record is queued with its monotonic capture time, so trips before the first
+// clock sync are uploaded (with the right timestamp) once the clock is set.
+void logShortCircuitEvent(uint32_t tripLatencyUs) {
+  EventRecord event = {voltage, current, power, cutoff.stateName(), tripLatencyUs, lastArcFeatures.score};
+  if (!uploadPipeline.queueEvent(lastSampleMonoUs, event)) {
+    LOG_WARN(FIREBASE, "⚠️ Event queue full, dropped oldest short circuit event");
+  }
+  flushShortCircuitEvents();
+}
+
+bool flushShortCircuitEvents() {
+  if (!cloudReady()) return true;
+  int queued = uploadPipeline.pendingEvents();
+  bool ok = uploadPipeline.flushEvents();
+  if (!ok) {
+    LOG_ERROR(FIREBASE, "Failed to log short circuit event, %d queued", uploadPipeline.pendingEvents());
+  } else if (uploadPipeline.pendingEvents() < queued) {
+    LOG_INFO(FIREBASE, "Short circuit event logged");
   }
+  return ok;
 }
 
 // ===== TIME FUNCTIONS =====
+// SNTP runs in the background; serviceTimebase() picks up the result
 void initTime() {
   configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-  Serial.print("Waiting for NTP time sync: ");
-  time_t nowSecs = time(nullptr);
-  while (nowSecs < 8 * 3600 * 2) {
-    delay(500);
-    Serial.print(".");
-    yield();
-    nowSecs = time(nullptr);
-  }
-  Serial.println();
-  struct tm timeinfo;
-  gmtime_r(&nowSecs, &timeinfo);
-  Serial.print("Current time: ");
-  Serial.print(asctime(&timeinfo));
+  Serial.println("NTP time sync started in background");
+  serviceTimebase();
 }
 
 // ===== MAIN SETUP =====
 void setup() {
   Serial.begin(115200);
+  initLogging();
   Serial.println("Smart Short Circuit Detection System Starting...");
+  initDeviceIdentity();
+  uploadPipeline.setDevicePrefix(devicePrefix);
+  uploadPipeline.setRollups(&rollups);
   
   // Initialize I2C
   Wire.begin();
   
+  // Arm load cutoff before anything that can block
+  initCutoff();
+  
   // Initialize display
   currentStatus = SYSTEM_STARTING;
   initDisplay();
@@ -761,6 +1575,9 @@ void setup() {
     while(1) delay(1000);
   }
   
+  // Arc detection (FFT setup + synthetic trace self-test)
+  initArcDetection();
+  
   // Initialize Firebase
   currentStatus = CLOUD_CONNECTING;
   if (!initFirebase()) {
@@ -777,8 +1594,10 @@ void setup() {
   delay(1000);
   
   currentStatus = MONITORING;
-  lastUpdate = millis();
+  samplePacer.start(millis(), paceSeed);
+  heartbeatPacer.start(millis(), paceSeed ^ 0x9E3779B9);
   lastDisplayUpdate = millis();
+  initPowerManagement();
   
   Serial.println("System fully initialized and ready for monitoring!");
   Serial.println("\n🔍 Debug: Monitor serial output for Firebase status updates every 5 seconds");
@@ -789,29 +1608,77 @@ void setup() {
 // ===== MAIN LOOP =====
 void loop() {
   unsigned long currentTime = millis();
+  unsigned long loopStartUs = micros();
+  
+  // Keep the timebase disciplined to NTP
+  serviceTimebase();
   
   // Read sensor data continuously
   readSensorData();
   
-  // Update Firebase at regular intervals
-  if (currentTime - lastUpdate >= UPDATE_INTERVAL) {
+  // Load cutoff retry/lockout handling
+  serviceCutoff();
+  
+  // Fold every sample into the minute/hour/day rollups
+  updateRollups();
+  
+  // Periodic high-rate capture for arc-fault signatures
+  serviceArcDetection();
+  
+  // Queue history at regular intervals, upload once a batch is full
+  static bool lastFaultState = false;
+  bool faultActive = shortCircuitDetected || cutoff.state() != CUTOFF_ARMED;
+  if (samplePacer.due(currentTime)) {
+    recordHistorySample();
+    if (uploadPipeline.due(currentTime)) {
+      uploadSensorData();
+    }
+  } else if (LOW_POWER_MODE && faultActive && !lastFaultState) {
+    // Faults are pushed immediately, even in the middle of a batch
+    recordHistorySample();
     uploadSensorData();
-    lastUpdate = currentTime;
+  }
+  lastFaultState = faultActive;
+  
+  // Keep the display on while a fault is active or the button is pressed
+  if (faultActive) wakeDisplay();
+#if CUTOFF_RESET_PIN >= 0
+  if (digitalRead(CUTOFF_RESET_PIN) == LOW) wakeDisplay();
+#endif
+  if (LOW_POWER_MODE && !displayBlanked && currentTime - lastActivityTime > DISPLAY_BLANK_TIMEOUT_MS) {
+    blankDisplay();
   }
   
   // Update display at regular intervals
-  if (currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
+  if (!displayBlanked && currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
     updateDisplay("MONITORING");
     lastDisplayUpdate = currentTime;
   }
   
+  // Low-rate fleet summary
+  if (heartbeatPacer.due(currentTime)) {
+    sendHeartbeat();
+  }
+  
+  // Prune expired raw samples and minute rollups in small batches
+  if (currentTime - lastPruneTime >= PRUNE_INTERVAL_MS) {
+    runRetention();
+    lastPruneTime = currentTime;
+  }
+  
   // Handle WiFi reconnection
   if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi disconnected, attempting to reconnect...");
+    LOG_WARN(WIFI, "WiFi disconnected, attempting to reconnect...");
     updateDisplay("WiFi", "Reconnecting...");
     connectToWiFi();
   }
   
-  // Small delay to prevent overwhelming the system
-  delay(50);
+  // Loop work timing (the sample wait below is excluded)
+  unsigned long loopWorkUs = micros() - loopStartUs;
+  if (loopWorkUs > loopWorkMaxUs) loopWorkMaxUs = loopWorkUs;
+  loopWorkTotalUs += loopWorkUs;
+  loopWorkCount++;
+  
+  // Sleep until the next sample slot
+  waitForNextSample();
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+// Native test support: the clocks seen by pipelines running against the RTDB
+// stand-in. Network calls take real time, while sample cadence and backoff
+// waits are skipped instead of slept. The stand-in's Date headers follow real
+// time, so the skipped time is added to the reference too; the device sees a
+// consistent, fast-forwarded world and its Timebase never steps.
+#pragma once
+
+#include <Timebase.h>
+#include <chrono>
+
+static int64_t skippedUs = 0;
+
+static int64_t realUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static int64_t harnessMonoUs() { return realUs() + skippedUs; }
+static uint32_t harnessMillis() { return harnessMonoUs() / 1000; }
+
+// Transports record Date headers at realUs() (see PosixRestTransport)
+static HttpDateClock dateClock;
+static bool dateReference(int64_t* epochUs) {
+  if (!dateClock.epochUsAt(realUs(), epochUs)) return false;
+  *epochUs += skippedUs;
+  return true;
+}
@@ -0,0 +1,270 @@
+// Native test support: runs tools/rtdb_standin.py as a child process and
+// talks to it through a POSIX keep-alive HTTP/1.1 client that implements
+// TelemetryTransport, so UploadPipeline runs unchanged against it.
+// Header-only, shared by the upload harness and fleet load suites.
+#pragma once
+
+#include <TelemetryTransport.h>
+#include <Timebase.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class PosixRestTransport : public TelemetryTransport {
+ public:
+  // Date headers are recorded into dateClock (if given) at monotonic() time
+  PosixRestTransport(int port, HttpDateClock* dateClock = nullptr, MonotonicClockFn monotonic = nullptr)
+      : port_(port), dateClock_(dateClock), monotonic_(monotonic) {}
+  ~PosixRestTransport() { disconnect(); }
+
+  int request(const char* method, const char* path, const char* body, size_t length,
+              char* response, size_t responseSize) override {
+    char target[384];
+    const char* query = strchr(path, '?');
+    int pathLength = query ? query - path : strlen(path);
+    snprintf(target, sizeof(target), "/%.*s.json?auth=test%s%s", pathLength, path, query ? "&" : "",
+             query ? query + 1 : "");
+    return rawRequest(method, target, body, length, response, responseSize);
+  }
+
+  bool connected() override { return fd_ >= 0; }
+
+  // Content-Length of the last response, even when the body was truncated
+  size_t lastBodyBytes() const { return bodyBytes_; }
+
+  void disconnect() override {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+  }
+
+  // Request with a complete target (path and query), e.g. the control endpoints
+  int rawRequest(const char* method, const char* target, const char* body, size_t length,
+                 char* response, size_t responseSize) {
+    if (fd_ < 0 && !connectSocket()) return -1;
+    char head[512];
+    int headLength = snprintf(head, sizeof(head),
+                              "%s %s HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/json\r\n"
+                              "Content-Length: %u\r\n\r\n", method, target, (unsigned)length);
+    if (!sendAll(head, headLength) || (length && !sendAll(body, length))) {
+      disconnect();
+      return -2;
+    }
+    return readResponse(response, responseSize);
+  }
+
+ private:
+  bool connectSocket() {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd_ < 0) return false;
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval timeout = {5, 0};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd_, (sockaddr*)&addr, sizeof(addr)) != 0) {
+      disconnect();
+      return false;
+    }
+    return true;
+  }
+
+  bool sendAll(const char* data, size_t length) {
+    while (length > 0) {
+      ssize_t sent = send(fd_, data, length, MSG_NOSIGNAL);
+      if (sent <= 0) return false;
+      data += sent;
+      length -= sent;
+    }
+    return true;
+  }
+
+  // Reads one response; the body goes to response if the status is 200
+  int readResponse(char* response, size_t responseSize) {
+    size_t have = 0;
+    char* headerEnd = nullptr;
+    while (!(headerEnd = findHeaderEnd(have))) {
+      if (have == sizeof(buffer_) - 1 || !receive(have)) {
+        disconnect();
+        return -3;   // Connection lost before a response (dropped request)
+      }
+    }
+    *headerEnd = '\0';
+    char* bodyStart = headerEnd + 4;
+    size_t bodyHave = have - (bodyStart - buffer_);
+
+    int status = 0;
+    if (sscanf(buffer_, "HTTP/1.%*d %d", &status) != 1) {
+      disconnect();
+      return -4;
+    }
+    size_t contentLength = 0;
+    bool closeAfter = false;
+    for (char* line = strstr(buffer_, "\r\n"); line; line = strstr(line, "\r\n")) {
+      line += 2;
+      if (strncasecmp(line, "Content-Length:", 15) == 0) contentLength = strtoul(line + 15, nullptr, 10);
+      if (strncasecmp(line, "Connection: close", 17) == 0) closeAfter = true;
+      if (strncasecmp(line, "Date: ", 6) == 0 && dateClock_ && monotonic_) {
+        char date[40];
+        snprintf(date, sizeof(date), "%.*s", (int)strcspn(line + 6, "\r"), line + 6);
+        dateClock_->record(date, monotonic_());
+      }
+    }
+
+    // Body: what already arrived with the headers, then the rest
+    size_t copied = 0;
+    auto take = [&](const char* data, size_t n) {
+      if (status == 200 && response && copied + 1 < responseSize) {
+        size_t room = responseSize - 1 - copied;
+        memcpy(response + copied, data, n < room ? n : room);
+        copied += n < room ? n : room;
+      }
+    };
+    bodyBytes_ = contentLength;
+    size_t remaining = contentLength;
+    size_t first = bodyHave < remaining ? bodyHave : remaining;
+    take(bodyStart, first);
+    remaining -= first;
+    while (remaining > 0) {
+      ssize_t got = recv(fd_, buffer_, remaining < sizeof(buffer_) ? remaining : sizeof(buffer_), 0);
+      if (got <= 0) {
+        disconnect();
+        return -3;
+      }
+      take(buffer_, got);
+      remaining -= got;
+    }
+    if (response && responseSize) response[copied] = '\0';
+    if (closeAfter) disconnect();
+    return status;
+  }
+
+  char* findHeaderEnd(size_t have) {
+    buffer_[have] = '\0';
+    return strstr(buffer_, "\r\n\r\n");
+  }
+
+  bool receive(size_t& have) {
+    ssize_t got = recv(fd_, buffer_ + have, sizeof(buffer_) - 1 - have, 0);
+    if (got <= 0) return false;
+    have += got;
+    return true;
+  }
+
+  int port_;
+  HttpDateClock* dateClock_;
+  MonotonicClockFn monotonic_;
+  int fd_ = -1;
+  size_t bodyBytes_ = 0;
+  char buffer_[4096];
+};
+
+// The stand-in server process
+class RtdbStandin {
+ public:
+  ~RtdbStandin() { stop(); }
+
+  // Starts the server on a free port. False if python3 or the script is missing.
+  bool start() {
+    char script[512];
+    if (!findScript(script, sizeof(script))) return false;
+    int out[2];
+    if (pipe(out) != 0) return false;
+    pid_ = fork();
+    if (pid_ == 0) {
+      dup2(out[1], STDOUT_FILENO);
+      close(out[0]);
+      close(out[1]);
+      execlp("python3", "python3", script, "--port", "0", "--seed", "7", (char*)nullptr);
+      _exit(127);
+    }
+    close(out[1]);
+    if (pid_ < 0) {
+      close(out[0]);
+      return false;
+    }
+
+    // First line is "READY <port>"
+    char line[64] = "";
+    size_t have = 0;
+    pollfd ready = {out[0], POLLIN, 0};
+    while (have < sizeof(line) - 1 && !strchr(line, '\n') && poll(&ready, 1, 10000) > 0) {
+      ssize_t got = read(out[0], line + have, sizeof(line) - 1 - have);
+      if (got <= 0) break;
+      have += got;
+      line[have] = '\0';
+    }
+    close(out[0]);
+    if (sscanf(line, "READY %d", &port_) != 1) {
+      stop();
+      return false;
+    }
+    control_ = new PosixRestTransport(port_);
+    return true;
+  }
+
+  void stop() {
+    delete control_;
+    control_ = nullptr;
+    if (pid_ > 0) {
+      kill(pid_, SIGTERM);
+      waitpid(pid_, nullptr, 0);
+    }
+    pid_ = -1;
+  }
+
+  int port() const { return port_; }
+
+  // Knobs or a profile, e.g. {"profile": "lossy"}
+  bool configure(const char* json) { return post("/__control", json); }
+  bool reset() { return post("/__reset", ""); }
+
+  bool stats(char* out, size_t size) {
+    return control_ && control_->rawRequest("GET", "/__stats", nullptr, 0, out, size) == 200;
+  }
+
+  // GET of any target (e.g. "/devices/x/sensor_data.json?shallow=true")
+  int get(const char* target, char* out, size_t size) {
+    return control_ ? control_->rawRequest("GET", target, nullptr, 0, out, size) : -1;
+  }
+  size_t lastBodyBytes() const { return control_ ? control_->lastBodyBytes() : 0; }
+
+ private:
+  bool post(const char* target, const char* json) {
+    char reply[256];
+    return control_ && control_->rawRequest("POST", target, json, strlen(json), reply, sizeof(reply)) == 200;
+  }
+
+  // RTDB_STANDIN overrides; otherwise tools/ relative to this header, then the cwd
+  static bool findScript(char* out, size_t size) {
+    const char* env = getenv("RTDB_STANDIN");
+    if (env) {
+      snprintf(out, size, "%s", env);
+      return access(out, R_OK) == 0;
+    }
+    const char* here = __FILE__;   // <project>/test/support/RtdbStandin.h
+    const char* slash = strrchr(here, '/');
+    if (slash) {
+      snprintf(out, size, "%.*s/../../tools/rtdb_standin.py", (int)(slash - here), here);
+      if (access(out, R_OK) == 0) return true;
+    }
+    snprintf(out, size, "tools/rtdb_standin.py");
+    return access(out, R_OK) == 0;
+  }
+
+  pid_t pid_ = -1;
+  int port_ = 0;
+  PosixRestTransport* control_ = nullptr;
+};
@@ -0,0 +1,114 @@
+// Arc scoring on synthetic traces, plus a per-frame cost benchmark
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <ArcDetect.h>
+
+static const ArcScoring SCORING = {{0.0f, 0.1f, 0.25f, 0.5f, 1.0f}, 0.01f, 0.01f};
+static const float SCORE_THRESHOLD = 0.5f;   // Same as ARC_SCORE_THRESHOLD in the firmware
+
+static ArcAnalyzer analyzer(SCORING);
+static float frame[ARC_MAX_FRAME];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void assertClassified(int n) {
+  char message[96];
+  for (int t = 0; t < ARC_TRACE_COUNT; t++) {
+    ArcTrace trace = (ArcTrace)t;
+    ArcFeatures features;
+    arcSyntheticTrace(trace, frame, n);
+    analyzer.analyze(frame, n, features);
+    snprintf(message, sizeof(message), "%s @ %d samples: score %.3f", arcTraceName(trace), n, features.score);
+    TEST_ASSERT_TRUE_MESSAGE((features.score >= SCORE_THRESHOLD) == arcTraceIsArc(trace), message);
+  }
+}
+
+void test_traces_classified_at_default_frame(void) {
+  assertClassified(128);
+}
+
+void test_traces_classified_at_all_frame_sizes(void) {
+  for (int n = 64; n <= ARC_MAX_FRAME; n *= 2) assertClassified(n);
+}
+
+void test_band_energy_is_normalized(void) {
+  ArcFeatures features;
+  arcSyntheticTrace(ARC_TRACE_SERIES_ARC, frame, 256);
+  analyzer.analyze(frame, 256, features);
+  float sum = 0;
+  for (int b = 0; b < ARC_BANDS; b++) sum += features.bandEnergy[b];
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 1.0, sum);
+}
+
+// A pure tone has near-zero flatness and all its energy in one band
+void test_tone_is_not_flat(void) {
+  const int n = 256;
+  for (int i = 0; i < n; i++) frame[i] = 2.0f + 0.5f * sinf(2.0f * 3.14159265f * 40.0f * i / n);
+  ArcFeatures features;
+  analyzer.analyze(frame, n, features);
+  TEST_ASSERT_LESS_THAN(0.05, features.flatness);
+  TEST_ASSERT_GREATER_THAN(0.95, features.bandEnergy[2]);   // Bin 40 of 128 = 0.31 Nyquist
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0.5 / sqrt(2.0), features.acRms);
+}
+
+void test_dc_only_scores_zero(void) {
+  for (int i = 0; i < 128; i++) frame[i] = 3.0f;
+  ArcFeatures features;
+  analyzer.analyze(frame, 128, features);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, features.score);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, features.acRms);
+}
+
+// Noise below 1% of a large load current is treated as sensor noise
+void test_small_relative_noise_is_ignored(void) {
+  arcSyntheticTrace(ARC_TRACE_SERIES_ARC, frame, 128);
+  for (int i = 0; i < 128; i++) frame[i] = 100.0f + (frame[i] - 2.0f) * 0.002f;
+  ArcFeatures features;
+  analyzer.analyze(frame, 128, features);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, features.score);
+}
+
+// Default INA219 config (32V, /8 gain, 12-bit, bus+shunt continuous) -> 9-bit shunt only
+void test_ina219_capture_config(void) {
+  TEST_ASSERT_EQUAL_UINT(0x3985, ina219ArcCaptureConfig(0x399F));
+  // 16V / 400mA calibration keeps its range and gain bits
+  TEST_ASSERT_EQUAL_UINT(0x0185, ina219ArcCaptureConfig(0x019F));
+  TEST_ASSERT_EQUAL_UINT(0x3985, ina219ArcCaptureConfig(0x3985));
+}
+
+// Host cost of analyze() per frame size. Only the relative scaling carries
+// over to the ESP32; the device self-test prints its own figures at boot.
+void test_benchmark_frame_sizes(void) {
+  char line[96];
+  double previous = 0;
+  for (int n = 64; n <= ARC_MAX_FRAME; n *= 2) {
+    const int runs = 2000;
+    ArcFeatures features;
+    arcSyntheticTrace(ARC_TRACE_SERIES_ARC, frame, n);
+    analyzer.analyze(frame, n, features);   // Window setup outside timing
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) analyzer.analyze(frame, n, features);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+    snprintf(line, sizeof(line), "%s FFT, %d samples: %.2fus/frame", ArcAnalyzer::backendName(), n, us);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(previous, us);
+    previous = us;
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  analyzer.begin();
+  RUN_TEST(test_traces_classified_at_default_frame);
+  RUN_TEST(test_traces_classified_at_all_frame_sizes);
+  RUN_TEST(test_band_energy_is_normalized);
+  RUN_TEST(test_tone_is_not_flat);
+  RUN_TEST(test_dc_only_scores_zero);
+  RUN_TEST(test_small_relative_noise_is_ignored);
+  RUN_TEST(test_ina219_capture_config);
+  RUN_TEST(test_benchmark_frame_sizes);
+  return UNITY_END();
+}
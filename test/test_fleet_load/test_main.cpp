@@ -0,0 +1,254 @@
+// Fleet load test: 100 simulated devices, each with its own UploadPipeline,
+// pacers and keep-alive connection, against the local RTDB stand-in. Checks
+// that every device stays inside its /devices/<id>/ namespace and keeps its
+// /fleet/<id> summary, and that start-up phase plus per-period jitter spread
+// the fleet's writes compared to boards booted in lockstep.
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <UploadPipeline.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "../support/HarnessClock.h"
+#include "../support/RtdbStandin.h"
+
+static RtdbStandin standin;
+
+const int FLEET_SIZE = 100;
+const uint32_t SAMPLE_INTERVAL_MS = 5000;
+const uint32_t UPLOAD_JITTER_MS = 1000;
+const uint32_t HEARTBEAT_INTERVAL_MS = 60000;
+const uint32_t TICK_MS = 100;
+const uint32_t RUN_MS = 10 * 60000;          // 10 minutes of fleet time per run
+
+static const TimebaseConfig TIMEBASE = {1000, 60000, 5000000, 500};
+static const UploadConfig CONFIG = {SAMPLE_INTERVAL_MS, 60000, 6, 2};
+
+// Fleet-wide request log: latency and the (fleet time) second it was sent in
+static std::vector<double> latenciesMs;
+static std::map<uint32_t, int> requestsPerSecond;
+static int64_t busyUs = 0;
+
+class LoggedTransport : public TelemetryTransport {
+ public:
+  explicit LoggedTransport(int port) : socket_(port, &dateClock, realUs) {}
+  int request(const char* method, const char* path, const char* body, size_t length,
+              char* response, size_t responseSize) override {
+    requestsPerSecond[harnessMillis() / 1000]++;
+    int64_t start = realUs();
+    int status = socket_.request(method, path, body, length, response, responseSize);
+    latenciesMs.push_back((realUs() - start) / 1000.0);
+    busyUs += realUs() - start;
+    return status;
+  }
+  bool connected() override { return socket_.connected(); }
+  void disconnect() override { socket_.disconnect(); }
+
+ private:
+  PosixRestTransport socket_;
+};
+
+struct SimDevice {
+  SimDevice(int index, int port)
+      : index(index),
+        transport(port),
+        pool(poolStorage, sizeof(poolStorage)),
+        writer(pool, buffer, sizeof(buffer)),
+        timebase(TIMEBASE, harnessMonoUs, dateReference),
+        pipeline(CONFIG, transport, writer, timebase, harnessMillis),
+        samplePacer(SAMPLE_INTERVAL_MS, UPLOAD_JITTER_MS),
+        heartbeatPacer(HEARTBEAT_INTERVAL_MS, UPLOAD_JITTER_MS) {
+    snprintf(id, sizeof(id), "sim-%03d", index);
+    snprintf(prefix, sizeof(prefix), "devices/%s/", id);
+    snprintf(fleetPath, sizeof(fleetPath), "fleet/%s", id);
+    pipeline.setDevicePrefix(prefix);
+  }
+
+  // Each device reports its own index as the voltage, so mixed-up paths show
+  float marker() const { return index; }
+
+  int index;
+  char id[16];
+  char prefix[32];
+  char fleetPath[32];
+  LoggedTransport transport;
+  alignas(8) uint8_t poolStorage[6144];
+  char buffer[2048];
+  TelemetryPool pool;
+  TelemetryWriter writer;
+  Timebase timebase;
+  UploadPipeline pipeline;
+  UploadPacer samplePacer;
+  UploadPacer heartbeatPacer;
+  int heartbeats = 0;
+};
+
+struct FleetResult {
+  int requests;
+  int peakPerSecond;
+  double meanPerSecond;
+  double p50Ms;
+  double p99Ms;
+  double requestsPerSec;       // Server throughput while busy
+};
+
+static std::vector<SimDevice*> fleet;
+static char response[65536];
+
+static double percentile(std::vector<double> values, int percent) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  size_t rank = (percent * values.size() + 99) / 100;
+  return values[(rank > 1 ? rank : 1) - 1];
+}
+
+static int countServerKeys(const char* path) {
+  char target[128];
+  snprintf(target, sizeof(target), "/%s.json?shallow=true", path);
+  if (standin.get(target, response, sizeof(response)) != 200) return -1;
+  int keys = 0;
+  for (const char* p = response; (p = strstr(p, ":true")); p++) keys++;
+  return keys;
+}
+
+static void destroyFleet() {
+  for (SimDevice* device : fleet) delete device;
+  fleet.clear();
+}
+
+static void sendHeartbeat(SimDevice& device) {
+  const UploadStats& stats = device.pipeline.stats();
+  HeartbeatStatus heartbeat = {device.marker(), 0.5f, device.marker() * 0.5f, "MONITORING",
+                               (long)(device.timebase.synced() ? device.timebase.nowEpochSeconds() : 0),
+                               (int)stats.requests, (int)stats.failures, 0, -60};
+  fillHeartbeat(device.writer.begin(), heartbeat);
+  device.writer.finish();
+  if (device.pipeline.send("PUT", device.fleetPath, false)) device.heartbeats++;
+}
+
+// lockstep: every board boots at the same instant and samples on the exact
+// period, as before per-device pacing; otherwise each board uses its pacers
+static FleetResult runFleet(bool lockstep, const char* label) {
+  TEST_ASSERT_TRUE(standin.reset());
+  TEST_ASSERT_TRUE(standin.configure("{\"profile\":\"clean\"}"));
+  latenciesMs.clear();
+  requestsPerSecond.clear();
+  busyUs = 0;
+  dateClock = HttpDateClock();
+
+  destroyFleet();
+  uint32_t startMs = harnessMillis();
+  for (int i = 0; i < FLEET_SIZE; i++) {
+    SimDevice* device = new SimDevice(i, standin.port());
+    uint32_t seed = (i + 1) * 2654435761u;   // Stands in for esp_random() ^ eFuse MAC
+    device->samplePacer.start(startMs, seed);
+    device->heartbeatPacer.start(startMs, seed ^ 0x9E3779B9);
+    fleet.push_back(device);
+  }
+
+  uint32_t lastLockstepSample = startMs;
+  uint32_t lastLockstepHeartbeat = startMs - HEARTBEAT_INTERVAL_MS;
+  for (uint32_t elapsed = 0; elapsed < RUN_MS; elapsed += TICK_MS) {
+    skippedUs += TICK_MS * 1000LL;
+    uint32_t now = harnessMillis();
+    bool lockstepSample = lockstep && now - lastLockstepSample >= SAMPLE_INTERVAL_MS;
+    bool lockstepHeartbeat = lockstep && now - lastLockstepHeartbeat >= HEARTBEAT_INTERVAL_MS;
+    if (lockstepSample) lastLockstepSample = now;
+    if (lockstepHeartbeat) lastLockstepHeartbeat = now;
+
+    for (SimDevice* device : fleet) {
+      device->timebase.service();
+      bool sample = lockstep ? lockstepSample : device->samplePacer.due(harnessMillis());
+      if (sample) {
+        device->pipeline.queueSample({harnessMonoUs(), device->marker(), 0.5f, device->marker() * 0.5f, false});
+        if (device->pipeline.due(harnessMillis())) {
+          LatestStatus latest = {device->marker(), 0.5f, device->marker() * 0.5f, false, "ARMED", 0.0f};
+          device->pipeline.upload(latest, harnessMonoUs());
+        }
+      }
+      bool heartbeat = lockstep ? lockstepHeartbeat : device->heartbeatPacer.due(harnessMillis());
+      if (heartbeat) sendHeartbeat(*device);
+    }
+  }
+
+  FleetResult result = {};
+  for (const auto& second : requestsPerSecond) {
+    result.requests += second.second;
+    result.peakPerSecond = std::max(result.peakPerSecond, second.second);
+  }
+  result.meanPerSecond = result.requests / (RUN_MS / 1000.0);
+  result.p50Ms = percentile(latenciesMs, 50);
+  result.p99Ms = percentile(latenciesMs, 99);
+  result.requestsPerSec = busyUs ? result.requests * 1e6 / busyUs : 0;
+
+  char line[200];
+  snprintf(line, sizeof(line),
+           "%-8s %d devices: %d requests, peak %d/s vs mean %.1f/s, p50 %.2fms p99 %.2fms, %.0f req/s",
+           label, FLEET_SIZE, result.requests, result.peakPerSecond, result.meanPerSecond, result.p50Ms,
+           result.p99Ms, result.requestsPerSec);
+  TEST_MESSAGE(line);
+  return result;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {
+  destroyFleet();
+}
+
+void test_devices_write_only_their_own_namespace(void) {
+  runFleet(false, "paced");
+
+  TEST_ASSERT_EQUAL(FLEET_SIZE, countServerKeys("devices"));
+  TEST_ASSERT_EQUAL(FLEET_SIZE, countServerKeys("fleet"));
+  // Nothing outside the namespaces: no global /latest or /sensor_data
+  TEST_ASSERT_EQUAL(2, countServerKeys(""));
+
+  for (SimDevice* device : fleet) {
+    const UploadStats& stats = device->pipeline.stats();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.samplesLost);
+    TEST_ASSERT_GREATER_THAN(0, device->heartbeats);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%ssensor_data", device->prefix);
+    TEST_ASSERT_EQUAL((int)stats.samplesDelivered, countServerKeys(path));
+
+    // Every stored sample and the summary carry this device's marker
+    char target[96];
+    snprintf(target, sizeof(target), "/%ssensor_data.json", device->prefix);
+    TEST_ASSERT_EQUAL(200, standin.get(target, response, sizeof(response)));
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, response));
+    for (JsonPair sample : doc.as<JsonObject>()) {
+      TEST_ASSERT_FLOAT_WITHIN(0.001, device->marker(), sample.value()[KEY_VOLTAGE].as<float>());
+    }
+    snprintf(target, sizeof(target), "/%s.json", device->fleetPath);
+    TEST_ASSERT_EQUAL(200, standin.get(target, response, sizeof(response)));
+    doc.clear();
+    TEST_ASSERT_FALSE(deserializeJson(doc, response));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, device->marker(), doc[KEY_VOLTAGE].as<float>());
+  }
+}
+
+void test_pacing_spreads_fleet_load(void) {
+  FleetResult lockstep = runFleet(true, "lockstep");
+  FleetResult paced = runFleet(false, "paced");
+
+  // Lockstep boards land every upload in the same second
+  TEST_ASSERT_GREATER_OR_EQUAL(FLEET_SIZE, lockstep.peakPerSecond);
+  // Jitter only shifts each slot, so the fleet's average load is unchanged
+  TEST_ASSERT_FLOAT_WITHIN(lockstep.meanPerSecond * 0.05, lockstep.meanPerSecond, paced.meanPerSecond);
+  TEST_ASSERT_LESS_THAN(lockstep.peakPerSecond / 3, paced.peakPerSecond);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  if (!standin.start()) {
+    printf("IGNORE: python3 or tools/rtdb_standin.py not available\n");
+    return UNITY_END();
+  }
+  RUN_TEST(test_devices_write_only_their_own_namespace);
+  RUN_TEST(test_pacing_spreads_fleet_load);
+  standin.stop();
+  return UNITY_END();
+}
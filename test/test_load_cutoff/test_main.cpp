@@ -0,0 +1,235 @@
+// Load cutoff state machine on the simulated GPIO backend
+#include <unity.h>
+#include <LoadCutoff.h>
+
+static uint32_t fakeMicros = 0;
+static int outputWrites = 0;
+static bool faultAsserted = false;
+
+static uint32_t clockMicros() { return fakeMicros; }
+static void recordWrite(bool) { outputWrites++; }
+static bool readFault() { return faultAsserted; }
+
+static const CutoffConfig AUTO_RETRY = {true, false, 3, 2000, 60000, 30000, 50};
+static const CutoffConfig LATCHING = {true, true, 3, 2000, 60000, 30000, 50};
+
+void setUp(void) {
+  fakeMicros = 1000;
+  outputWrites = 0;
+  faultAsserted = false;
+}
+
+void tearDown(void) {}
+
+// The output level must always match the state: connected only when armed
+static void assertConsistent(const LoadCutoff& cutoff) {
+  TEST_ASSERT_EQUAL(cutoff.state() != CUTOFF_ARMED, cutoff.disconnected());
+}
+
+void test_trip_disconnects_and_records_latency(void) {
+  LoadCutoff cutoff(AUTO_RETRY, clockMicros, recordWrite);
+  cutoff.begin();
+  TEST_ASSERT_FALSE(cutoff.disconnected());
+
+  fakeMicros = 5012;
+  cutoff.trip(5000);
+  TEST_ASSERT_EQUAL(CUTOFF_TRIPPED, cutoff.state());
+  TEST_ASSERT_TRUE(cutoff.disconnected());
+  TEST_ASSERT_TRUE(cutoff.outputLevel());   // Active high
+  TEST_ASSERT_EQUAL_UINT32(12, cutoff.lastTripLatencyUs());
+  TEST_ASSERT_EQUAL(2, outputWrites);       // begin() + trip()
+
+  uint8_t events = cutoff.service(0, false);
+  TEST_ASSERT_TRUE(events & CUTOFF_EVENT_TRIPPED);
+  TEST_ASSERT_TRUE(events & CUTOFF_EVENT_RETRY_SCHEDULED);
+  TEST_ASSERT_EQUAL_UINT32(1, cutoff.tripCount());
+
+  // The trip is reported exactly once
+  TEST_ASSERT_FALSE(cutoff.service(1, false) & CUTOFF_EVENT_TRIPPED);
+}
+
+void test_trip_ignored_unless_armed(void) {
+  LoadCutoff cutoff(AUTO_RETRY, clockMicros);
+  cutoff.begin();
+  fakeMicros = 2000;
+  cutoff.trip(1990);
+  fakeMicros = 9000;
+  cutoff.trip(1000);
+  TEST_ASSERT_EQUAL_UINT32(10, cutoff.lastTripLatencyUs());
+  cutoff.service(0, false);
+  TEST_ASSERT_EQUAL_UINT32(1, cutoff.tripCount());
+}
+
+void test_active_low_output(void) {
+  CutoffConfig config = AUTO_RETRY;
+  config.activeHigh = false;
+  LoadCutoff cutoff(config, clockMicros);
+  cutoff.begin();
+  TEST_ASSERT_TRUE(cutoff.outputLevel());
+  cutoff.trip(fakeMicros);
+  TEST_ASSERT_FALSE(cutoff.outputLevel());
+  TEST_ASSERT_TRUE(cutoff.disconnected());
+}
+
+void test_auto_retry_backoff_doubles_until_lockout(void) {
+  LoadCutoff cutoff(AUTO_RETRY, clockMicros);
+  cutoff.begin();
+  uint32_t now = 0;
+  const uint32_t expectedBackoff[] = {2000, 4000, 8000};
+
+  for (int retry = 0; retry < 3; retry++) {
+    cutoff.trip(fakeMicros);
+    cutoff.service(now, false);
+    TEST_ASSERT_EQUAL(CUTOFF_TRIPPED, cutoff.state());
+    TEST_ASSERT_EQUAL_UINT32(expectedBackoff[retry], cutoff.retryBackoffMs());
+
+    // Still disconnected 1ms before the retry is due
+    TEST_ASSERT_FALSE(cutoff.service(now + expectedBackoff[retry] - 1, false) & CUTOFF_EVENT_RECLOSED);
+    assertConsistent(cutoff);
+    now += expectedBackoff[retry];
+    TEST_ASSERT_TRUE(cutoff.service(now, false) & CUTOFF_EVENT_RECLOSED);
+    TEST_ASSERT_EQUAL(CUTOFF_ARMED, cutoff.state());
+    assertConsistent(cutoff);
+  }
+
+  cutoff.trip(fakeMicros);
+  uint8_t events = cutoff.service(now, false);
+  TEST_ASSERT_TRUE(events & CUTOFF_EVENT_LOCKOUT);
+  TEST_ASSERT_EQUAL(CUTOFF_LOCKOUT, cutoff.state());
+
+  // Lockout never re-closes on its own
+  cutoff.service(now + 3600000, false);
+  TEST_ASSERT_EQUAL(CUTOFF_LOCKOUT, cutoff.state());
+  assertConsistent(cutoff);
+}
+
+void test_backoff_is_capped(void) {
+  CutoffConfig config = AUTO_RETRY;
+  config.maxRetries = 40;
+  LoadCutoff cutoff(config, clockMicros);
+  cutoff.begin();
+  uint32_t now = 0;
+  for (int i = 0; i < 40; i++) {
+    cutoff.trip(fakeMicros);
+    cutoff.service(now, false);
+    TEST_ASSERT_LESS_OR_EQUAL(60000, cutoff.retryBackoffMs());
+    now += cutoff.retryBackoffMs();
+    cutoff.service(now, false);
+  }
+  TEST_ASSERT_EQUAL_UINT32(60000, cutoff.retryBackoffMs());
+}
+
+void test_latching_locks_out_on_first_trip(void) {
+  LoadCutoff cutoff(LATCHING, clockMicros);
+  cutoff.begin();
+  cutoff.trip(fakeMicros);
+  TEST_ASSERT_TRUE(cutoff.service(0, false) & CUTOFF_EVENT_LOCKOUT);
+  TEST_ASSERT_TRUE(cutoff.reset(10));
+  TEST_ASSERT_EQUAL(CUTOFF_ARMED, cutoff.state());
+  TEST_ASSERT_FALSE(cutoff.reset(20));      // Already armed
+}
+
+void test_held_reset_button_resets_once(void) {
+  LoadCutoff cutoff(LATCHING, clockMicros);
+  cutoff.begin();
+  cutoff.trip(fakeMicros);
+  cutoff.service(0, false);
+
+  // Hold the button for 10s with the short still present: the load is
+  // re-closed once, trips again and then stays locked out
+  int resets = 0;
+  for (uint32_t now = 10; now < 10000; now += 50) {
+    if (cutoff.service(now, true) & CUTOFF_EVENT_RESET) resets++;
+    if (cutoff.state() == CUTOFF_ARMED) cutoff.trip(fakeMicros);
+    assertConsistent(cutoff);
+  }
+  TEST_ASSERT_EQUAL(1, resets);
+  TEST_ASSERT_EQUAL(CUTOFF_LOCKOUT, cutoff.state());
+  TEST_ASSERT_EQUAL_UINT32(2, cutoff.tripCount());
+
+  // Release, then a second press resets again
+  cutoff.service(10000, false);
+  cutoff.service(10100, false);
+  cutoff.service(10200, true);
+  TEST_ASSERT_TRUE(cutoff.service(10300, true) & CUTOFF_EVENT_RESET);
+}
+
+void test_reset_button_debounce(void) {
+  LoadCutoff cutoff(LATCHING, clockMicros);
+  cutoff.begin();
+  cutoff.trip(fakeMicros);
+  cutoff.service(0, false);
+
+  // Contact bounce shorter than the debounce time is ignored
+  for (uint32_t now = 100; now < 300; now += 20) {
+    cutoff.service(now, (now / 20) % 2 == 0);
+  }
+  cutoff.service(300, false);
+  TEST_ASSERT_EQUAL(CUTOFF_LOCKOUT, cutoff.state());
+
+  cutoff.service(400, true);
+  TEST_ASSERT_FALSE(cutoff.service(420, true) & CUTOFF_EVENT_RESET);
+  TEST_ASSERT_EQUAL(CUTOFF_LOCKOUT, cutoff.state());
+  TEST_ASSERT_TRUE(cutoff.service(450, true) & CUTOFF_EVENT_RESET);
+  TEST_ASSERT_EQUAL(CUTOFF_ARMED, cutoff.state());
+}
+
+void test_reclose_into_asserted_fault_trips_again(void) {
+  LoadCutoff cutoff(AUTO_RETRY, clockMicros, recordWrite, readFault);
+  cutoff.begin();
+  faultAsserted = true;
+  cutoff.trip(fakeMicros);
+  cutoff.service(0, false);
+
+  // The fault input never produced a new edge; the level check catches it
+  cutoff.service(2000, false);
+  TEST_ASSERT_EQUAL(CUTOFF_TRIPPED, cutoff.state());
+  assertConsistent(cutoff);
+  TEST_ASSERT_TRUE(cutoff.service(2001, false) & CUTOFF_EVENT_TRIPPED);
+  TEST_ASSERT_EQUAL_UINT32(2, cutoff.tripCount());
+
+  faultAsserted = false;
+  cutoff.service(2001 + cutoff.retryBackoffMs(), false);
+  TEST_ASSERT_EQUAL(CUTOFF_ARMED, cutoff.state());
+}
+
+void test_retry_count_clears_after_healthy_period(void) {
+  LoadCutoff cutoff(AUTO_RETRY, clockMicros);
+  cutoff.begin();
+  cutoff.trip(fakeMicros);
+  cutoff.service(0, false);
+  cutoff.service(2000, false);
+  TEST_ASSERT_EQUAL(1, cutoff.retryCount());
+
+  cutoff.service(2000 + 30000, false);
+  TEST_ASSERT_EQUAL(1, cutoff.retryCount());
+  cutoff.service(2000 + 30001, false);
+  TEST_ASSERT_EQUAL(0, cutoff.retryCount());
+}
+
+void test_filter_reset_after_reclose(void) {
+  LoadCutoff cutoff(AUTO_RETRY, clockMicros);
+  cutoff.begin();
+  TEST_ASSERT_FALSE(cutoff.consumeFilterReset());
+  cutoff.trip(fakeMicros);
+  cutoff.service(0, false);
+  cutoff.service(2000, false);
+  TEST_ASSERT_TRUE(cutoff.consumeFilterReset());
+  TEST_ASSERT_FALSE(cutoff.consumeFilterReset());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_trip_disconnects_and_records_latency);
+  RUN_TEST(test_trip_ignored_unless_armed);
+  RUN_TEST(test_active_low_output);
+  RUN_TEST(test_auto_retry_backoff_doubles_until_lockout);
+  RUN_TEST(test_backoff_is_capped);
+  RUN_TEST(test_latching_locks_out_on_first_trip);
+  RUN_TEST(test_held_reset_button_resets_once);
+  RUN_TEST(test_reset_button_debounce);
+  RUN_TEST(test_reclose_into_asserted_fault_trips_again);
+  RUN_TEST(test_retry_count_clears_after_healthy_period);
+  RUN_TEST(test_filter_reset_after_reclose);
+  return UNITY_END();
+}
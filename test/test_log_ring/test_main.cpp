@@ -0,0 +1,242 @@
+// Log ring, rate limiter, compile-time filters and the loop time with and
+// without the ring against a modeled UART
+#include <unity.h>
+#include <LogRing.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t fakeMillis = 0;
+static int notifications = 0;
+static int sideEffects = 0;
+
+static uint32_t clockMillis() { return fakeMillis; }
+static void countNotify() { notifications++; }
+static int sideEffect() { return ++sideEffects; }
+
+void setUp(void) {
+  fakeMillis = 1000;
+  notifications = 0;
+  sideEffects = 0;
+}
+
+void tearDown(void) {}
+
+void test_records_come_out_in_order(void) {
+  LogRing ring(clockMillis);
+  ring.setNotify(countNotify);
+  LogSite a = {}, b = {};
+  TEST_ASSERT_TRUE(ring.write(a, LOG_LEVEL_INFO, "SYSTEM", "boot %d", 1));
+  fakeMillis = 1500;
+  TEST_ASSERT_TRUE(ring.write(b, LOG_LEVEL_ERROR, "SENSOR", "short at %.1fA", 2.5));
+  TEST_ASSERT_EQUAL(2, notifications);
+
+  LogRecord record;
+  char line[LOG_LINE_MAX];
+  TEST_ASSERT_TRUE(ring.pop(record));
+  logFormatLine(record, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("[1000][I][SYSTEM] boot 1\n", line);
+  TEST_ASSERT_TRUE(ring.pop(record));
+  logFormatLine(record, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("[1500][E][SENSOR] short at 2.5A\n", line);
+  TEST_ASSERT_FALSE(ring.pop(record));
+  TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_full_ring_drops_new_records(void) {
+  LogRing ring(clockMillis, 1000, 255);
+  LogSite site = {};
+  for (int i = 0; i < LOG_RING_SIZE; i++) {
+    TEST_ASSERT_TRUE(ring.write(site, LOG_LEVEL_INFO, "SYSTEM", "%d", i));
+  }
+  TEST_ASSERT_FALSE(ring.write(site, LOG_LEVEL_INFO, "SYSTEM", "overflow"));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.dropped());
+
+  // The oldest records are kept, and the slot frees up once drained
+  LogRecord record;
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL_STRING("0", record.message);
+  TEST_ASSERT_TRUE(ring.write(site, LOG_LEVEL_INFO, "SYSTEM", "after"));
+}
+
+void test_rate_limit_reports_suppressed_count(void) {
+  LogRing ring(clockMillis, 1000, 3);
+  LogSite site = {}, other = {};
+  int written = 0;
+  for (int i = 0; i < 10; i++) {
+    if (ring.write(site, LOG_LEVEL_WARN, "WIFI", "reconnect")) written++;
+  }
+  TEST_ASSERT_EQUAL(3, written);
+  TEST_ASSERT_EQUAL_UINT32(7, ring.suppressed());
+
+  // Other call sites have their own budget
+  TEST_ASSERT_TRUE(ring.write(other, LOG_LEVEL_WARN, "WIFI", "other"));
+
+  // The next window's first record carries the suppressed count
+  fakeMillis += 1000;
+  TEST_ASSERT_TRUE(ring.write(site, LOG_LEVEL_WARN, "WIFI", "reconnect"));
+  LogRecord record;
+  while (ring.pop(record)) {}
+  TEST_ASSERT_EQUAL_STRING("reconnect (+7 suppressed)", record.message);
+}
+
+void test_long_messages_are_truncated(void) {
+  LogRing ring(clockMillis);
+  LogSite site = {};
+  char longText[300];
+  memset(longText, 'x', sizeof(longText) - 1);
+  longText[sizeof(longText) - 1] = '\0';
+  ring.write(site, LOG_LEVEL_INFO, "SYSTEM", "%s", longText);
+
+  LogRecord record;
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL(LOG_MSG_MAX - 1, (int)strlen(record.message));
+  char line[LOG_LINE_MAX];
+  size_t length = logFormatLine(record, line, sizeof(line));
+  TEST_ASSERT_EQUAL('\n', line[length - 1]);
+
+  char small[16];
+  length = logFormatLine(record, small, sizeof(small));
+  TEST_ASSERT_EQUAL(sizeof(small) - 1, length);
+  TEST_ASSERT_EQUAL('\n', small[length - 1]);
+}
+
+// Default build: LOG_LEVEL info, all categories on
+void test_compile_time_filter(void) {
+  TEST_ASSERT_TRUE(LOG_ENABLED(LOG_LEVEL_ERROR, SENSOR));
+  TEST_ASSERT_TRUE(LOG_ENABLED(LOG_LEVEL_INFO, FIREBASE));
+  TEST_ASSERT_FALSE(LOG_ENABLED(LOG_LEVEL_DEBUG, SYSTEM));
+
+  // A filtered statement does not even evaluate its arguments
+  LogRing ring(clockMillis);
+  LOG_TO(ring, LOG_LEVEL_DEBUG, SENSOR, "%d", sideEffect());
+  TEST_ASSERT_EQUAL(0, sideEffects);
+  TEST_ASSERT_TRUE(ring.empty());
+  LOG_TO(ring, LOG_LEVEL_INFO, SENSOR, "%d", sideEffect());
+  TEST_ASSERT_EQUAL(1, sideEffects);
+  TEST_ASSERT_FALSE(ring.empty());
+}
+
+// ----- Loop time with and without the ring -----
+
+// UART at 115200 8N1 with a 128 byte TX FIFO: a write returns once the bytes
+// that don't fit in the FIFO have been shifted out
+struct ModeledUart {
+  static constexpr double BYTE_US = 10 * 1000000.0 / 115200;
+  static constexpr int FIFO_BYTES = 128;
+  double busyUntilUs = 0;
+  size_t bytes = 0;
+
+  // Returns how long the writer was blocked
+  double write(double nowUs, size_t length) {
+    double queued = busyUntilUs > nowUs ? (busyUntilUs - nowUs) / BYTE_US : 0;
+    busyUntilUs = (busyUntilUs > nowUs ? busyUntilUs : nowUs) + length * BYTE_US;
+    bytes += length;
+    double overflow = queued + length - FIFO_BYTES;
+    return overflow > 0 ? overflow * BYTE_US : 0;
+  }
+};
+
+static ModeledUart uart;
+static double simNowUs = 0;
+static double blockedUs = 0;
+
+static void blockingSink(const char*, size_t length) {
+  blockedUs += uart.write(simNowUs + blockedUs, length);
+}
+
+struct LoopStats {
+  double avgUs;
+  double maxUs;
+  uint32_t dropped;
+};
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One minute at the 100ms sample interval: a status line every second, the
+// periodic stats every 10s and a short circuit trip burst in the middle
+static LoopStats runLoop(bool synchronous) {
+  const int iterations = 600;
+  const double intervalUs = 100000;
+  LogRing ring(clockMillis);
+  if (synchronous) ring.setSynchronousSink(blockingSink);
+  uart = ModeledUart();
+  simNowUs = 0;
+
+  static LogSite status, trip, latency, retry, lockout, stats1, stats2, stats3;
+  LoopStats result = {0, 0, 0};
+  for (int i = 0; i < iterations; i++) {
+    fakeMillis = simNowUs / 1000;
+    blockedUs = 0;
+    auto start = std::chrono::steady_clock::now();
+    if (i % 10 == 0) {
+      ring.write(status, LOG_LEVEL_INFO, "SENSOR", "Sensor Status - V: %.3fV, I: %.3fA, P: %.3fW, Mode: %s",
+                 12.034, 0.412, 4.958, "NORMAL");
+    }
+    if (i == 300) {
+      ring.write(trip, LOG_LEVEL_ERROR, "SENSOR",
+                 "SHORT CIRCUIT DETECTED! V: %.3fV, I: %.3fA, P: %.3fW, zero count: %d, arc: %.3f",
+                 0.214, 7.912, 1.693, 0, 0.118);
+      ring.write(latency, LOG_LEVEL_WARN, "SYSTEM", "Load disconnected, latency: %luus", 38UL);
+      ring.write(retry, LOG_LEVEL_INFO, "SYSTEM", "Auto-retry %d/%d in %lums", 1, 3, 2000UL);
+      ring.write(lockout, LOG_LEVEL_INFO, "FIREBASE", "Short circuit event logged");
+    }
+    if (i % 100 == 99) {
+      ring.write(stats1, LOG_LEVEL_INFO, "FIREBASE", "Uploads: %d ok, %d failed (%.1f%%), last %lums",
+                 58, 2, 3.3, 412UL);
+      ring.write(stats2, LOG_LEVEL_INFO, "SYSTEM",
+                 "Cutoff trips: %lu (max latency %luus), sample overruns: %lu, est. avg current: %.1fmA",
+                 1UL, 38UL, 0UL, 41.5);
+      ring.write(stats3, LOG_LEVEL_INFO, "SYSTEM", "Loop work: avg %luus, max %luus; log dropped: %lu, suppressed: %lu",
+                 820UL, 1900UL, 0UL, 0UL);
+    }
+    double loopUs = elapsedUs(start) + blockedUs;
+    result.avgUs += loopUs / iterations;
+    if (loopUs > result.maxUs) result.maxUs = loopUs;
+
+    // Drain task: drains the ring into the UART, blocking only itself
+    if (!synchronous) {
+      LogRecord record;
+      char line[LOG_LINE_MAX];
+      while (ring.pop(record)) uart.write(simNowUs, logFormatLine(record, line, sizeof(line)));
+    }
+    simNowUs += intervalUs;
+  }
+  result.dropped = ring.dropped();
+  return result;
+}
+
+void test_loop_time_before_and_after_ring(void) {
+  LoopStats before = runLoop(true);
+  size_t bytesBefore = uart.bytes;
+  LoopStats after = runLoop(false);
+
+  char message[200];
+  snprintf(message, sizeof(message), "blocking Serial: loop avg %.1fus, max %.1fus (UART model, 115200 baud)",
+           before.avgUs, before.maxUs);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "log ring:        loop avg %.1fus, max %.1fus, dropped %lu",
+           after.avgUs, after.maxUs, (unsigned long)after.dropped);
+  TEST_MESSAGE(message);
+
+  // Same output, none of it lost
+  TEST_ASSERT_EQUAL(bytesBefore, uart.bytes);
+  TEST_ASSERT_EQUAL_UINT32(0, after.dropped);
+  // The trip burst overflows the FIFO and blocks for >10ms; the ring doesn't
+  TEST_ASSERT_GREATER_THAN(10000, before.maxUs);
+  TEST_ASSERT_LESS_THAN(1000, after.maxUs);
+  TEST_ASSERT_LESS_THAN(before.avgUs, after.avgUs);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_come_out_in_order);
+  RUN_TEST(test_full_ring_drops_new_records);
+  RUN_TEST(test_rate_limit_reports_suppressed_count);
+  RUN_TEST(test_long_messages_are_truncated);
+  RUN_TEST(test_compile_time_filter);
+  RUN_TEST(test_loop_time_before_and_after_ring);
+  return UNITY_END();
+}
@@ -0,0 +1,322 @@
+// Rollup aggregation and retention. The aggregation tests are pure; the
+// rest run the pipeline and Retention against the local RTDB stand-in
+// (tools/rtdb_standin.py), including the 30-day dashboard read sizes.
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <Retention.h>
+#include <RollupAggregator.h>
+#include <UploadPipeline.h>
+#include <math.h>
+#include <string.h>
+#include "../support/RtdbStandin.h"
+
+static RtdbStandin standin;
+static bool standinRunning = false;
+
+static const time_t DAY0 = 1699920000;        // 2023-11-14 00:00:00 UTC
+static const TimebaseConfig TIMEBASE = {1000, 60000, 5000000, 500};
+static const UploadConfig CONFIG = {5000, 60000, 6, 2};
+static const LatestStatus LATEST = {12.0f, 1.0f, 12.0f, false, "ARMED", 0.0f};
+static const RetentionConfig RETENTION = {7, 14, 25};
+
+// The clock is never synced here: rollups carry their own epoch keys
+static uint32_t fakeMillis = 0;
+static int64_t fakeMonoUs = 0;
+static uint32_t clockMillis() { return fakeMillis; }
+static int64_t fakeMonotonic() { return fakeMonoUs; }
+static bool noReference(int64_t*) { return false; }
+
+alignas(8) static uint8_t poolStorage[6144];
+static char buffer[3072];
+static char pruneResponse[4096];
+static char response[16 * 1024 * 1024];   // Shallow listing of 30 days of raw keys
+
+// Bulk loading: one PATCH per hour of raw samples
+alignas(8) static uint8_t bulkPoolStorage[2 * 1024 * 1024];
+static char bulkBuffer[160 * 1024];
+
+struct Device {
+  explicit Device(int port) : transport(port) { pipeline.setDevicePrefix("devices/bench/"); }
+
+  PosixRestTransport transport;
+  TelemetryPool pool{poolStorage, sizeof(poolStorage)};
+  TelemetryWriter writer{pool, buffer, sizeof(buffer)};
+  Timebase timebase{TIMEBASE, fakeMonotonic, noReference};
+  UploadPipeline pipeline{CONFIG, transport, writer, timebase, clockMillis};
+  RollupAggregator rollups;
+
+  Device(const Device&) = delete;
+
+  // One reading every 5 s from start (inclusive) to end (exclusive)
+  void feed(time_t start, time_t end, float (*powerAt)(time_t), bool (*faultAt)(time_t) = nullptr) {
+    RollupBucket closed[ROLLUP_LEVELS];
+    for (time_t t = start; t < end; t += 5) {
+      fakeMillis += 5000;
+      float power = powerAt(t);
+      int count = rollups.add(fakeMillis, t, 12.0f, power / 12.0f, power, faultAt && faultAt(t), closed);
+      for (int i = 0; i < count; i++) pipeline.queueRollup(closed[i]);
+    }
+  }
+};
+
+static float constant12W(time_t) { return 12.0f; }
+static float varyingPower(time_t t) { return 50.0f + 10.0f * sinf(t / 600.0f); }
+
+static int countServerKeys(const char* path) {
+  char target[128];
+  snprintf(target, sizeof(target), "/%s.json?shallow=true", path);
+  if (standin.get(target, response, sizeof(response)) != 200) return -1;
+  int keys = 0;
+  for (const char* p = response; (p = strstr(p, ":true")); p++) keys++;
+  return keys;
+}
+
+// Bytes of a dashboard-style range read (orderBy="$key", startAt/endAt)
+static size_t rangeReadBytes(const char* path, const char* startKey, const char* endKey) {
+  char target[256];
+  snprintf(target, sizeof(target), "/%s.json?orderBy=%%22%%24key%%22&startAt=%%22%s%%22&endAt=%%22%s%%22",
+           path, startKey, endKey);
+  TEST_ASSERT_EQUAL(200, standin.get(target, response, sizeof(response)));
+  return standin.lastBodyBytes();
+}
+
+static void requireStandin() {
+  if (!standinRunning) TEST_IGNORE_MESSAGE("python3 or tools/rtdb_standin.py not available");
+  TEST_ASSERT_TRUE(standin.reset());
+  TEST_ASSERT_TRUE(standin.configure("{\"profile\":\"clean\"}"));
+}
+
+void setUp(void) {
+  fakeMillis = 100000;
+  fakeMonoUs = 10000000;
+}
+
+void tearDown(void) {}
+
+// ----- Aggregation -----
+
+void test_minute_bucket_summarizes_and_rolls_over(void) {
+  RollupAggregator rollups;
+  RollupBucket closed[ROLLUP_LEVELS];
+  const float volts[] = {12.0f, 11.0f, 13.0f, 12.0f};
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(0, rollups.add(1000 * i, DAY0 + 15 * i, volts[i], 1.0f, volts[i], false, closed));
+  }
+  const RollupBucket& minute = rollups.open(ROLLUP_MINUTE);
+  TEST_ASSERT_EQUAL(DAY0, minute.start);
+  TEST_ASSERT_EQUAL_UINT32(4, minute.samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 11.0, minute.voltage.min);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 13.0, minute.voltage.max);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 12.0, minute.voltage.sum / minute.samples);
+
+  // The next minute closes only the minute bucket
+  TEST_ASSERT_EQUAL(1, rollups.add(4000, DAY0 + 60, 12.5f, 1.0f, 12.5f, false, closed));
+  TEST_ASSERT_EQUAL(ROLLUP_MINUTE, closed[0].level);
+  TEST_ASSERT_EQUAL(DAY0, closed[0].start);
+  TEST_ASSERT_EQUAL_UINT32(4, closed[0].samples);
+  TEST_ASSERT_EQUAL_UINT32(1, rollups.open(ROLLUP_MINUTE).samples);
+  TEST_ASSERT_EQUAL_UINT32(5, rollups.open(ROLLUP_HOUR).samples);
+
+  // Midnight closes all three
+  TEST_ASSERT_EQUAL(3, rollups.add(5000, DAY0 + 86400, 12.0f, 1.0f, 12.0f, false, closed));
+}
+
+void test_energy_integrates_power_over_reading_intervals(void) {
+  RollupAggregator rollups;
+  RollupBucket closed[ROLLUP_LEVELS];
+  uint32_t ms = 0;
+  int count = 0;
+  for (time_t t = DAY0; t <= DAY0 + 3600; t += 5, ms += 5000) {
+    count = rollups.add(ms, t, 12.0f, 5.0f, 60.0f, false, closed);
+  }
+  // 720 readings in the hour, 719 intervals of 5 s at 60 W; the interval
+  // ending on the boundary belongs to the next hour
+  TEST_ASSERT_EQUAL(2, count);
+  TEST_ASSERT_EQUAL(ROLLUP_HOUR, closed[1].level);
+  TEST_ASSERT_EQUAL_UINT32(720, closed[1].samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 719 * 5 * 60.0 / 3600.0, closed[1].energyWh);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 5 * 60.0 / 3600.0, rollups.open(ROLLUP_HOUR).energyWh);
+}
+
+void test_faults_count_onsets_not_readings(void) {
+  RollupAggregator rollups;
+  RollupBucket closed[ROLLUP_LEVELS];
+  // Onset while the clock is not set: tracked, not bucketed, not counted again later
+  rollups.add(0, 0, 0, 0, 0, true, closed);
+  const bool faults[] = {true, false, true, true, true, false, true};
+  for (int i = 0; i < 7; i++) rollups.add(1000 * (i + 1), DAY0 + i, 12.0f, 0, 0, faults[i], closed);
+  TEST_ASSERT_EQUAL(2, rollups.open(ROLLUP_MINUTE).faults);
+  TEST_ASSERT_EQUAL(2, rollups.open(ROLLUP_DAY).faults);
+  TEST_ASSERT_EQUAL_UINT32(7, rollups.open(ROLLUP_DAY).samples);
+}
+
+void test_merge_combines_partial_buckets(void) {
+  RollupBucket before = {ROLLUP_HOUR, DAY0, 10, {11.0f, 12.0f, 115.0}, {1.0f, 2.0f, 15.0}, {11.0f, 24.0f, 170.0}, 1.5, 1};
+  RollupBucket after = {ROLLUP_HOUR, DAY0, 5, {11.5f, 13.0f, 61.0}, {0.5f, 1.0f, 4.0}, {6.0f, 13.0f, 49.0}, 0.5, 2};
+  mergeRollup(&after, before);
+  TEST_ASSERT_EQUAL_UINT32(15, after.samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 11.0, after.voltage.min);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 13.0, after.voltage.max);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 176.0, after.voltage.sum);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 0.5, after.current.min);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 24.0, after.power.max);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 2.0, after.energyWh);
+  TEST_ASSERT_EQUAL(3, after.faults);
+
+  // Round trip through the wire format
+  JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  addRollup(root, "hour", after);
+  RollupBucket read;
+  char key[24];
+  snprintf(key, sizeof(key), "hour/%ld", (long)DAY0);
+  TEST_ASSERT_TRUE(readRollup(root[(const char*)key].as<JsonObject>(), ROLLUP_HOUR, DAY0, &read));
+  TEST_ASSERT_EQUAL_UINT32(15, read.samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 176.0, read.voltage.sum);
+}
+
+// ----- Against the stand-in -----
+
+void test_reboot_mid_hour_keeps_earlier_summary(void) {
+  requireStandin();
+  const time_t HOUR = DAY0 + 10 * 3600;
+  {
+    Device before(standin.port());
+    before.pipeline.setRollups(&before.rollups);
+    for (int minute = 0; minute < 20; minute++) {
+      before.feed(HOUR + minute * 60, HOUR + minute * 60 + 60, constant12W);
+      TEST_ASSERT_TRUE(before.pipeline.upload(LATEST, fakeMonoUs));
+    }
+  }
+  // Reboot: fresh aggregator and pipeline, same hour
+  Device after(standin.port());
+  after.pipeline.setRollups(&after.rollups);
+  for (int minute = 20; minute < 40; minute++) {
+    after.feed(HOUR + minute * 60, HOUR + minute * 60 + 60, constant12W);
+    TEST_ASSERT_TRUE(after.pipeline.upload(LATEST, fakeMonoUs));
+  }
+
+  char target[96];
+  snprintf(target, sizeof(target), "/devices/bench/rollups/hour/%ld.json", (long)HOUR);
+  TEST_ASSERT_EQUAL(200, standin.get(target, response, sizeof(response)));
+  JsonDocument doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, response));
+  TEST_ASSERT_EQUAL(480, doc[KEY_SAMPLES].as<int>());
+  // 2 x 239 intervals of 5 s at 12 W; the gap across the reboot is not counted
+  TEST_ASSERT_FLOAT_WITHIN(0.002, 2 * 239 * 5 * 12.0 / 3600.0, doc[KEY_ENERGY].as<float>());
+}
+
+void test_retention_prunes_expired_nodes_in_batches(void) {
+  requireStandin();
+  const time_t NOW = DAY0 + 10 * 86400;
+  PosixRestTransport loader(standin.port());
+  TelemetryPool bulkPool(bulkPoolStorage, sizeof(bulkPoolStorage));
+  TelemetryWriter bulk(bulkPool, bulkBuffer, sizeof(bulkBuffer));
+
+  // Raw samples hourly over the last 10 days, minute buckets every 30 min over 20
+  JsonObject root = bulk.begin();
+  int rawKept = 0;
+  for (int hour = 0; hour < 240; hour++) {
+    time_t t = DAY0 + hour * 3600;
+    addHistoryEntry(root, t * 1000000LL, 12.0f, 1.0f, 12.0f, false);
+    rawKept += t > NOW - RETENTION.rawDays * 86400L;
+  }
+  TEST_ASSERT_EQUAL(TELEMETRY_OK, bulk.finish());
+  TEST_ASSERT_EQUAL(200, loader.request("PATCH", "devices/bench/sensor_data", bulk.data(), bulk.length(), nullptr, 0));
+  root = bulk.begin();
+  int minutesKept = 0;
+  for (int slot = 0; slot < 960; slot++) {
+    RollupBucket bucket = {ROLLUP_MINUTE, DAY0 - 10 * 86400 + slot * 1800, 12, {12, 12, 144}, {1, 1, 12}, {12, 12, 144}, 0.2, 0};
+    addRollup(root, "minute", bucket);
+    minutesKept += bucket.start > NOW - RETENTION.minuteRollupDays * 86400L;
+  }
+  TEST_ASSERT_EQUAL(TELEMETRY_OK, bulk.finish());
+  TEST_ASSERT_EQUAL(200, loader.request("PATCH", "devices/bench/rollups", bulk.data(), bulk.length(), nullptr, 0));
+
+  Device device(standin.port());
+  Retention retention(RETENTION, device.pipeline, device.writer, pruneResponse, sizeof(pruneResponse));
+  int idle = 0;
+  int calls = 0;
+  while (idle < 2 && calls < 100) {
+    int deleted = retention.service(NOW);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, deleted);
+    TEST_ASSERT_LESS_OR_EQUAL(RETENTION.batchSize, deleted);
+    idle = deleted == 0 ? idle + 1 : 0;
+    calls++;
+  }
+  TEST_ASSERT_EQUAL(rawKept, countServerKeys("devices/bench/sensor_data"));
+  TEST_ASSERT_EQUAL(minutesKept, countServerKeys("devices/bench/rollups/minute"));
+  TEST_ASSERT_EQUAL_UINT32(0, retention.skippedKeys());
+  TEST_ASSERT_EQUAL_UINT32(0, device.pipeline.stats().failures);
+}
+
+// 30 days at the 5 s upload cadence: raw /sensor_data as the dashboard read
+// it before rollups, against the day (and hour) buckets it reads now
+void test_thirty_day_range_read_sizes(void) {
+  requireStandin();
+  const int DAYS = 30;
+  const time_t END = DAY0 + DAYS * 86400;
+  PosixRestTransport loader(standin.port());
+  TelemetryPool bulkPool(bulkPoolStorage, sizeof(bulkPoolStorage));
+  TelemetryWriter bulk(bulkPool, bulkBuffer, sizeof(bulkBuffer));
+  Device device(standin.port());
+  device.pipeline.setRollups(&device.rollups);
+
+  double expectedDayEnergy = 0;   // Day 0, same integration as the aggregator
+  for (time_t hour = DAY0; hour < END; hour += 3600) {
+    JsonObject root = bulk.begin();
+    for (time_t t = hour; t < hour + 3600; t += 5) {
+      addHistoryEntry(root, t * 1000000LL, 12.0f, varyingPower(t) / 12.0f, varyingPower(t), false);
+      if (t > DAY0 && t < DAY0 + 86400) expectedDayEnergy += varyingPower(t) * 5 / 3600.0;
+    }
+    TEST_ASSERT_EQUAL(TELEMETRY_OK, bulk.finish());
+    TEST_ASSERT_EQUAL(200, loader.request("PATCH", "devices/bench/sensor_data", bulk.data(), bulk.length(),
+                                          nullptr, 0));
+    device.feed(hour, hour + 3600, varyingPower);
+    TEST_ASSERT_TRUE(device.pipeline.upload(LATEST, fakeMonoUs));
+  }
+
+  char startUs[20], endUs[20], start[16], end[16];
+  formatTimeKey(startUs, sizeof(startUs), DAY0 * 1000000LL);
+  formatTimeKey(endUs, sizeof(endUs), END * 1000000LL);
+  snprintf(start, sizeof(start), "%ld", (long)DAY0);
+  snprintf(end, sizeof(end), "%ld", (long)END);
+  size_t rawBytes = rangeReadBytes("devices/bench/sensor_data", startUs, endUs);
+  size_t hourBytes = rangeReadBytes("devices/bench/rollups/hour", start, end);
+  size_t dayBytes = rangeReadBytes("devices/bench/rollups/day", start, end);
+
+  char line[200];
+  snprintf(line, sizeof(line), "30-day read: raw %d nodes %lu B, hour buckets %d nodes %lu B, day buckets %d nodes %lu B",
+           countServerKeys("devices/bench/sensor_data"), (unsigned long)rawBytes,
+           countServerKeys("devices/bench/rollups/hour"), (unsigned long)hourBytes,
+           countServerKeys("devices/bench/rollups/day"), (unsigned long)dayBytes);
+  TEST_MESSAGE(line);
+
+  TEST_ASSERT_EQUAL(DAYS * 17280, countServerKeys("devices/bench/sensor_data"));
+  TEST_ASSERT_EQUAL(DAYS * 24, countServerKeys("devices/bench/rollups/hour"));
+  TEST_ASSERT_EQUAL(DAYS, countServerKeys("devices/bench/rollups/day"));
+  TEST_ASSERT_LESS_THAN(rawBytes / 1000, dayBytes);
+
+  // Day buckets are complete: every reading, energy matching the raw data
+  char target[96];
+  snprintf(target, sizeof(target), "/devices/bench/rollups/day/%ld.json", (long)DAY0);
+  TEST_ASSERT_EQUAL(200, standin.get(target, response, sizeof(response)));
+  JsonDocument doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, response));
+  TEST_ASSERT_EQUAL(17280, doc[KEY_SAMPLES].as<int>());
+  TEST_ASSERT_FLOAT_WITHIN(0.01, expectedDayEnergy, doc[KEY_ENERGY].as<float>());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_minute_bucket_summarizes_and_rolls_over);
+  RUN_TEST(test_energy_integrates_power_over_reading_intervals);
+  RUN_TEST(test_faults_count_onsets_not_readings);
+  RUN_TEST(test_merge_combines_partial_buckets);
+  standinRunning = standin.start();
+  RUN_TEST(test_reboot_mid_hour_keeps_earlier_summary);
+  RUN_TEST(test_retention_prunes_expired_nodes_in_batches);
+  RUN_TEST(test_thirty_day_range_read_sizes);
+  standin.stop();
+  return UNITY_END();
+}
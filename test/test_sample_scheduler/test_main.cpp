@@ -0,0 +1,107 @@
+// Sample cadence and power estimate, driven by a simulated millisecond clock
+#include <unity.h>
+#include <SampleScheduler.h>
+
+static const PowerModel MODEL = {40.0f, 0.8f, 95.0f, 20.0f, 12.0f, 1.0f};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_interval_clamped_to_latency_budget(void) {
+  TEST_ASSERT_EQUAL_UINT32(50, SampleScheduler(50, 100).intervalMs());
+  TEST_ASSERT_EQUAL_UINT32(100, SampleScheduler(250, 100).intervalMs());
+}
+
+// Samples land on a fixed grid regardless of how long each sample's work takes
+void test_cadence_does_not_drift(void) {
+  SampleScheduler scheduler(100, 100);
+  uint32_t now = 1000;
+  scheduler.start(now);
+  uint32_t seed = 12345;
+  for (int i = 1; i <= 1000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    now += (seed >> 16) % 90;           // Work: 0..89 ms, always inside the slot
+    now += scheduler.next(now);
+    TEST_ASSERT_EQUAL_UINT32(1000 + (uint32_t)i * 100, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.overruns());
+}
+
+void test_overrun_resyncs_without_burst(void) {
+  SampleScheduler scheduler(50, 100);
+  scheduler.start(0);
+  TEST_ASSERT_EQUAL_UINT32(50, scheduler.next(0));
+
+  // A 2s blocking upload: one overrun, then back on a 50ms cadence from now
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.next(2050));
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.overruns());
+  TEST_ASSERT_EQUAL_UINT32(50, scheduler.next(2050));
+  TEST_ASSERT_EQUAL_UINT32(40, scheduler.next(2110));
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.overruns());
+}
+
+void test_slot_hit_exactly_is_not_an_overrun(void) {
+  SampleScheduler scheduler(50, 100);
+  scheduler.start(0);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.next(50));
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.overruns());
+}
+
+void test_sample_now_after_fault_wake(void) {
+  SampleScheduler scheduler(100, 100);
+  scheduler.start(0);
+  scheduler.next(0);                 // Waiting for t=100
+  scheduler.sampleNow(37);           // Fault input woke the CPU at t=37
+  TEST_ASSERT_EQUAL_UINT32(100, scheduler.next(37));
+  TEST_ASSERT_EQUAL_UINT32(137, scheduler.nextAtMs());
+}
+
+void test_cadence_across_millis_wrap(void) {
+  SampleScheduler scheduler(100, 100);
+  uint32_t now = 0xFFFFFF00u;
+  scheduler.start(now);
+  for (int i = 0; i < 10; i++) {
+    now += 5;
+    now += scheduler.next(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFF00u + 1000u, now);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.overruns());
+}
+
+void test_awake_fraction(void) {
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0, awakeFraction(0, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.02, awakeFraction(2000, 100000));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0, awakeFraction(150, 100));
+}
+
+void test_current_estimate(void) {
+  float normal = estimateAverageCurrentMA(MODEL, 1.0f, false, false, true);
+  float lowPower = estimateAverageCurrentMA(MODEL, 0.02f, true, true, true);
+  float blanked = estimateAverageCurrentMA(MODEL, 0.02f, true, true, false);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 40.0 + 95.0 + 1.0 + 12.0, normal);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0.02 * 40.0 + 0.98 * 0.8 + 20.0 + 1.0 + 12.0, lowPower);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 12.0, lowPower - blanked);
+}
+
+void test_idle_without_light_sleep_counts_as_awake(void) {
+  // Normal mode: a mostly idle loop still draws the full awake current
+  TEST_ASSERT_FLOAT_WITHIN(0.01, estimateAverageCurrentMA(MODEL, 1.0f, false, false, true),
+                           estimateAverageCurrentMA(MODEL, 0.05f, false, false, true));
+  // Low-power mode with modem sleep only
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 40.0 + 20.0 + 1.0 + 12.0,
+                           estimateAverageCurrentMA(MODEL, 0.02f, false, true, true));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_interval_clamped_to_latency_budget);
+  RUN_TEST(test_cadence_does_not_drift);
+  RUN_TEST(test_overrun_resyncs_without_burst);
+  RUN_TEST(test_slot_hit_exactly_is_not_an_overrun);
+  RUN_TEST(test_sample_now_after_fault_wake);
+  RUN_TEST(test_cadence_across_millis_wrap);
+  RUN_TEST(test_awake_fraction);
+  RUN_TEST(test_current_estimate);
+  RUN_TEST(test_idle_without_light_sleep_counts_as_awake);
+  return UNITY_END();
+}
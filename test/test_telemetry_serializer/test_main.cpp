@@ -0,0 +1,204 @@
+// Payload wire format, pool-only allocation and serialization cost
+#include <unity.h>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <TelemetryPayloads.h>
+#include <TelemetryWriter.h>
+
+// Counts heap allocations made while payloads are built
+static volatile size_t heapAllocations = 0;
+void* operator new(size_t size) {
+  heapAllocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static const size_t POOL_SIZE = 6144;     // Same sizes as the firmware
+static const size_t BUFFER_SIZE = 3072;
+alignas(8) static uint8_t poolStorage[POOL_SIZE];
+static char buffer[BUFFER_SIZE];
+static TelemetryPool pool(poolStorage, POOL_SIZE);
+static TelemetryWriter writer(pool, buffer, BUFFER_SIZE);
+
+static const int64_t EPOCH_US = 1700000000123456LL;
+static const int HISTORY_BATCH = 12;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static bool buildLatest() {
+  LatestStatus latest = {12.3456f, 1.2344f, 15.2391f, false, "ARMED", 0.1234f};
+  fillLatest(writer.begin(), EPOCH_US, latest);
+  return writer.finish() == TELEMETRY_OK;
+}
+
+static bool buildEvent() {
+  EventRecord event = {11.9f, 25.5f, 303.45f, "TRIPPED", 18, 0.91f};
+  fillEvent(writer.begin(), EPOCH_US, event);
+  return writer.finish() == TELEMETRY_OK;
+}
+
+static bool buildHistory() {
+  JsonObject root = writer.begin();
+  for (int i = 0; i < HISTORY_BATCH; i++) {
+    addHistoryEntry(root, EPOCH_US + i * 5000000LL, 12.345f, 1.234f, 15.234f, i == 3);
+  }
+  return writer.finish() == TELEMETRY_OK;
+}
+
+static bool buildRollups() {
+  static const char* const NAMES[] = {"minute", "hour", "day"};
+  RollupBucket bucket = {};
+  bucket.samples = 1200;
+  bucket.voltage = {11.8f, 12.4f, 12.1 * 1200};
+  bucket.current = {0.9f, 1.6f, 1.2 * 1200};
+  bucket.power = {10.6f, 19.8f, 14.5 * 1200};
+  bucket.energyWh = 0.2417;
+  JsonObject root = writer.begin();
+  for (int i = 0; i < 7; i++) {        // 4 closed + 3 open buckets
+    bucket.level = i % 3;
+    bucket.start = 1700000000 + i * 60;
+    addRollup(root, NAMES[bucket.level], bucket);
+  }
+  return writer.finish() == TELEMETRY_OK;
+}
+
+void test_latest_payload_format(void) {
+  TEST_ASSERT_TRUE(buildLatest());
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"timestamp\":\"1700000000\",\"timestampUs\":1700000000123456,\"voltage\":12.346,"
+      "\"current\":1.234,\"power\":15.239,\"shortCircuit\":false,\"cutoffState\":\"ARMED\","
+      "\"arcScore\":0.123}",
+      writer.data());
+  TEST_ASSERT_EQUAL_size_t(strlen(writer.data()), writer.length());
+}
+
+void test_event_payload_format(void) {
+  TEST_ASSERT_TRUE(buildEvent());
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"timestamp\":\"1700000000\",\"timestampUs\":1700000000123456,\"voltage\":11.9,"
+      "\"current\":25.5,\"power\":303.45,\"severity\":\"HIGH\",\"cutoffState\":\"TRIPPED\","
+      "\"tripLatencyUs\":18,\"arcScore\":0.91}",
+      writer.data());
+}
+
+void test_reading_without_clock_omits_timestamps(void) {
+  fillReading(writer.begin(), 0, 1.0f, 2.0f, 3.0f);
+  TEST_ASSERT_EQUAL(TELEMETRY_OK, writer.finish());
+  TEST_ASSERT_EQUAL_STRING("{\"voltage\":1,\"current\":2,\"power\":3}", writer.data());
+}
+
+void test_heartbeat_omits_last_seen_without_clock(void) {
+  HeartbeatStatus heartbeat = {12.0f, 1.0f, 12.0f, "OK", 0, 5, 1, 2, -61};
+  fillHeartbeat(writer.begin(), heartbeat);
+  TEST_ASSERT_EQUAL(TELEMETRY_OK, writer.finish());
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"voltage\":12,\"current\":1,\"power\":12,\"status\":\"OK\",\"uploads\":5,"
+      "\"failedUploads\":1,\"trips\":2,\"rssi\":-61}",
+      writer.data());
+}
+
+// Keys and timestamps come from stack buffers that are reused for every
+// entry; each one must have been copied into the pool
+void test_history_keys_and_timestamps_are_copied(void) {
+  TEST_ASSERT_TRUE(buildHistory());
+  char expected[64];
+  for (int i = 0; i < HISTORY_BATCH; i++) {
+    int64_t epochUs = EPOCH_US + i * 5000000LL;
+    snprintf(expected, sizeof(expected), "\"%016lld\":{\"timestamp\":\"%lld\"",
+             (long long)epochUs, (long long)(epochUs / 1000000LL));
+    TEST_ASSERT_NOT_NULL(strstr(writer.data(), expected));
+  }
+}
+
+void test_rollup_keys_are_copied(void) {
+  TEST_ASSERT_TRUE(buildRollups());
+  TEST_ASSERT_NOT_NULL(strstr(writer.data(), "\"minute/1700000000\":{\"vMin\":11.8,"));
+  TEST_ASSERT_NOT_NULL(strstr(writer.data(), "\"day/1700000300\":"));
+  TEST_ASSERT_NOT_NULL(strstr(writer.data(), "\"iMean\":1.2,"));
+}
+
+void test_time_key_is_sortable(void) {
+  char early[20], late[20];
+  formatTimeKey(early, sizeof(early), 999999999999999LL);
+  formatTimeKey(late, sizeof(late), 1000000000000000LL);
+  TEST_ASSERT_EQUAL_size_t(16, strlen(early));
+  TEST_ASSERT_LESS_THAN(0, strcmp(early, late));
+}
+
+void test_pool_overflow_is_reported(void) {
+  alignas(8) static uint8_t tinyStorage[256];
+  static char tinyBuffer[BUFFER_SIZE];
+  TelemetryPool tinyPool(tinyStorage, sizeof(tinyStorage));
+  TelemetryWriter tiny(tinyPool, tinyBuffer, sizeof(tinyBuffer));
+  JsonObject root = tiny.begin();
+  for (int i = 0; i < HISTORY_BATCH; i++) {
+    addHistoryEntry(root, EPOCH_US + i, 1.0f, 1.0f, 1.0f, false);
+  }
+  TEST_ASSERT_EQUAL(TELEMETRY_POOL_OVERFLOW, tiny.finish());
+  TEST_ASSERT_EQUAL_size_t(0, tiny.length());
+}
+
+void test_buffer_overflow_is_reported(void) {
+  static char smallBuffer[64];
+  TelemetryWriter small(pool, smallBuffer, sizeof(smallBuffer));
+  LatestStatus latest = {12.3456f, 1.2344f, 15.2391f, false, "ARMED", 0.1234f};
+  fillLatest(small.begin(), EPOCH_US, latest);
+  TEST_ASSERT_EQUAL(TELEMETRY_BUFFER_OVERFLOW, small.finish());
+  TEST_ASSERT_EQUAL_size_t(0, small.length());
+  TEST_ASSERT_EQUAL(TELEMETRY_OK, small.setRaw("\"ESP32_Connected\""));
+  TEST_ASSERT_EQUAL_size_t(17, small.length());
+}
+
+// Host benchmark: cost per payload, pool high-water mark and heap allocations.
+// Host timings only rank payloads against each other; Test 5 on the device
+// reports the same figures for the ESP32.
+static void benchmark(const char* name, bool (*build)(), size_t maxPoolBytes) {
+  const int runs = 2000;
+  TEST_ASSERT_TRUE(build());   // Warm up
+  pool.resetPeak();
+  size_t allocationsBefore = heapAllocations;
+  auto start = std::chrono::steady_clock::now();
+  bool ok = true;
+  for (int i = 0; i < runs; i++) ok &= build();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  size_t allocations = heapAllocations - allocationsBefore;
+
+  char line[128];
+  snprintf(line, sizeof(line), "%s: %u bytes, %.2fus, pool peak %u B, heap allocations %u", name,
+           (unsigned)writer.length(),
+           std::chrono::duration<double, std::micro>(elapsed).count() / runs,
+           (unsigned)pool.peak(), (unsigned)allocations);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL_size_t(0, allocations);
+  TEST_ASSERT_LESS_OR_EQUAL(maxPoolBytes, pool.peak());
+}
+
+void test_benchmark_payloads(void) {
+  benchmark("latest", buildLatest, POOL_SIZE);
+  benchmark("event", buildEvent, POOL_SIZE);
+  benchmark("history x12", buildHistory, POOL_SIZE);
+  benchmark("rollups x7", buildRollups, POOL_SIZE);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_latest_payload_format);
+  RUN_TEST(test_event_payload_format);
+  RUN_TEST(test_reading_without_clock_omits_timestamps);
+  RUN_TEST(test_heartbeat_omits_last_seen_without_clock);
+  RUN_TEST(test_history_keys_and_timestamps_are_copied);
+  RUN_TEST(test_rollup_keys_are_copied);
+  RUN_TEST(test_time_key_is_sortable);
+  RUN_TEST(test_pool_overflow_is_reported);
+  RUN_TEST(test_buffer_overflow_is_reported);
+  RUN_TEST(test_benchmark_payloads);
+  return UNITY_END();
+}
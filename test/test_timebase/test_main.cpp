@@ -0,0 +1,211 @@
+// Timebase discipline against a fake monotonic clock and a fake reference
+#include <unity.h>
+#include <Timebase.h>
+
+static int64_t fakeMonoUs = 0;
+static int64_t fakeReferenceOffsetUs = 0;   // Reference = monotonic + this
+static bool referenceValid = false;
+static int referencePolls = 0;
+
+static int64_t fakeMonotonic() { return fakeMonoUs; }
+static bool fakeReference(int64_t* epochUs) {
+  referencePolls++;
+  if (!referenceValid) return false;
+  *epochUs = fakeMonoUs + fakeReferenceOffsetUs;
+  return true;
+}
+
+static const TimebaseConfig CONFIG = {1000, 60000, 5000000, 500};
+static const int64_t EPOCH_OFFSET_US = 1700000000000000LL;
+
+void setUp(void) {
+  fakeMonoUs = 10000000;
+  fakeReferenceOffsetUs = EPOCH_OFFSET_US;
+  referenceValid = false;
+  referencePolls = 0;
+}
+
+void tearDown(void) {}
+
+// Runs service() every stepUs for durationUs of monotonic time
+static void runFor(Timebase& timebase, int64_t durationUs, int64_t stepUs) {
+  for (int64_t end = fakeMonoUs + durationUs; fakeMonoUs < end;) {
+    fakeMonoUs += stepUs;
+    timebase.service();
+  }
+}
+
+void test_first_sync_steps_offset(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  TEST_ASSERT_EQUAL(TIMEBASE_IDLE, timebase.service());
+  TEST_ASSERT_FALSE(timebase.synced());
+
+  referenceValid = true;
+  fakeMonoUs += 1000000;
+  TEST_ASSERT_EQUAL(TIMEBASE_SYNCED, timebase.service());
+  TEST_ASSERT_TRUE(timebase.synced());
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US, timebase.offsetUs());
+
+  // Samples captured before the sync convert with the same offset
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US + 5000000, timebase.epochUsAt(5000000));
+}
+
+// The poll schedule follows the injected monotonic clock, not millis()
+void test_poll_cadence_uses_monotonic_clock(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  runFor(timebase, 10000000, 10000);          // 10s unsynced, service every 10ms
+  TEST_ASSERT_INT_WITHIN(1, 10, referencePolls);
+
+  referenceValid = true;
+  fakeMonoUs += 1000000;
+  timebase.service();
+  TEST_ASSERT_TRUE(timebase.synced());
+  referencePolls = 0;
+  runFor(timebase, 600000000, 100000);        // 10 min synced
+  TEST_ASSERT_INT_WITHIN(1, 10, referencePolls);
+}
+
+void test_small_error_is_slewed_at_max_rate(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  referenceValid = true;
+  timebase.service();
+
+  fakeReferenceOffsetUs += 1000;              // Reference moves 1ms ahead
+  fakeMonoUs += 60000000;
+  TEST_ASSERT_EQUAL(TIMEBASE_SLEWING, timebase.service());
+  TEST_ASSERT_EQUAL_INT64(1000, timebase.slewRemainingUs());
+
+  // 500ppm: 1ms takes 2s, never faster
+  runFor(timebase, 1000000, 100000);
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US + 500, timebase.offsetUs());
+  runFor(timebase, 1000000, 100000);
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US + 1000, timebase.offsetUs());
+  TEST_ASSERT_EQUAL_INT64(0, timebase.slewRemainingUs());
+}
+
+// At 500ppm a call every 1ms earns 0.5us; the remainder must carry over
+// instead of truncating to zero on every call
+void test_slew_carries_budget_between_frequent_calls(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  referenceValid = true;
+  timebase.service();
+
+  fakeReferenceOffsetUs -= 1000;
+  fakeMonoUs += 60000000;
+  timebase.service();
+  runFor(timebase, 1000000, 1000);
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US - 500, timebase.offsetUs());
+  runFor(timebase, 1000000, 1000);
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US - 1000, timebase.offsetUs());
+
+  // Also at 100us per call (0.05us budget each)
+  fakeReferenceOffsetUs += 200;
+  fakeMonoUs += 60000000;
+  timebase.service();
+  runFor(timebase, 400000, 100);
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US - 800, timebase.offsetUs());
+}
+
+void test_large_error_is_stepped(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  referenceValid = true;
+  timebase.service();
+
+  fakeReferenceOffsetUs += 7000000;
+  fakeMonoUs += 60000000;
+  TEST_ASSERT_EQUAL(TIMEBASE_STEPPED, timebase.service());
+  TEST_ASSERT_EQUAL_INT64(7000000, timebase.lastStepUs());
+  TEST_ASSERT_EQUAL_INT64(EPOCH_OFFSET_US + 7000000, timebase.offsetUs());
+}
+
+// A backwards slew slows epoch time down but never makes it go backwards
+void test_epoch_time_is_monotonic_while_slewing_back(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  referenceValid = true;
+  timebase.service();
+
+  fakeReferenceOffsetUs -= 4000000;          // Just under the step threshold
+  fakeMonoUs += 60000000;
+  timebase.service();
+  int64_t previous = timebase.nowEpochUs();
+  for (int i = 0; i < 20000; i++) {
+    fakeMonoUs += 500;
+    timebase.service();
+    int64_t now = timebase.nowEpochUs();
+    TEST_ASSERT_GREATER_THAN(previous, now);
+    // 500us of monotonic time advances epoch time by at least 500us - 500ppm
+    TEST_ASSERT_GREATER_OR_EQUAL(499, now - previous);
+    previous = now;
+  }
+}
+
+void test_now_epoch_us_never_repeats(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  referenceValid = true;
+  timebase.service();
+  int64_t first = timebase.nowEpochUs();
+  TEST_ASSERT_EQUAL_INT64(first + 1, timebase.nowEpochUs());
+  TEST_ASSERT_EQUAL_INT64(first + 2, timebase.nowEpochUs());
+}
+
+void test_set_clock_sources_resets_sync(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, fakeReference);
+  referenceValid = true;
+  timebase.service();
+  TEST_ASSERT_TRUE(timebase.synced());
+  timebase.setClockSources(fakeMonotonic, fakeReference);
+  TEST_ASSERT_FALSE(timebase.synced());
+  TEST_ASSERT_EQUAL_INT64(0, timebase.offsetUs());
+  TEST_ASSERT_EQUAL(TIMEBASE_SYNCED, timebase.service());
+}
+
+void test_parse_http_date(void) {
+  int64_t seconds = 0;
+  TEST_ASSERT_TRUE(parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", &seconds));
+  TEST_ASSERT_EQUAL_INT64(784111777, seconds);
+  TEST_ASSERT_TRUE(parseHttpDate("Thu, 29 Feb 2024 23:59:59 GMT", &seconds));
+  TEST_ASSERT_EQUAL_INT64(1709251199, seconds);
+
+  TEST_ASSERT_FALSE(parseHttpDate("Sun, 06 Nov 1994 08:49:37", &seconds));
+  TEST_ASSERT_FALSE(parseHttpDate("Sun, 06 Nox 1994 08:49:37 GMT", &seconds));
+  TEST_ASSERT_FALSE(parseHttpDate("", &seconds));
+  TEST_ASSERT_FALSE(parseHttpDate(nullptr, &seconds));
+}
+
+// HttpDateClock feeding the timebase: synced without NTP, within a second
+static HttpDateClock dateClock;
+static bool dateReference(int64_t* epochUs) {
+  return dateClock.epochUsAt(fakeMonoUs, epochUs);
+}
+
+void test_http_date_reference_syncs_timebase(void) {
+  Timebase timebase(CONFIG, fakeMonotonic, dateReference);
+  dateClock = HttpDateClock();
+  runFor(timebase, 5000000, 100000);
+  TEST_ASSERT_FALSE(timebase.synced());
+
+  dateClock.record("Tue, 14 Nov 2023 22:13:20 GMT", fakeMonoUs);   // 1700000000
+  runFor(timebase, 2000000, 100000);
+  TEST_ASSERT_TRUE(timebase.synced());
+  int64_t expected = 1700000000000000LL + 2000000;
+  TEST_ASSERT_INT_WITHIN(1000000, expected, timebase.epochUsAt(fakeMonoUs));
+
+  // A malformed header leaves the last good reference in place
+  dateClock.record("garbage", fakeMonoUs);
+  TEST_ASSERT_TRUE(dateClock.valid());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_sync_steps_offset);
+  RUN_TEST(test_poll_cadence_uses_monotonic_clock);
+  RUN_TEST(test_small_error_is_slewed_at_max_rate);
+  RUN_TEST(test_slew_carries_budget_between_frequent_calls);
+  RUN_TEST(test_large_error_is_stepped);
+  RUN_TEST(test_epoch_time_is_monotonic_while_slewing_back);
+  RUN_TEST(test_now_epoch_us_never_repeats);
+  RUN_TEST(test_set_clock_sources_resets_sync);
+  RUN_TEST(test_parse_http_date);
+  RUN_TEST(test_http_date_reference_syncs_timebase);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+// Offline upload harness: the device's UploadPipeline against the local RTDB
+// stand-in (tools/rtdb_standin.py) under scripted network profiles. No NTP
+// and no cloud: the clock syncs from the stand-in's Date headers, as it does
+// on the device when REST_BASE_URL points at a LAN stand-in.
+#include <unity.h>
+#include <UploadPipeline.h>
+#include <algorithm>
+#include <vector>
+#include "../support/HarnessClock.h"
+#include "../support/RtdbStandin.h"
+
+static RtdbStandin standin;
+
+// Times every exchange, so the percentiles cover the whole run
+class TimedTransport : public TelemetryTransport {
+ public:
+  explicit TimedTransport(TelemetryTransport& inner) : inner_(inner) {}
+  int request(const char* method, const char* path, const char* body, size_t length,
+              char* response, size_t responseSize) override {
+    int64_t start = realUs();
+    int status = inner_.request(method, path, body, length, response, responseSize);
+    latenciesMs.push_back((realUs() - start) / 1000.0);
+    busyUs += realUs() - start;
+    return status;
+  }
+  bool connected() override { return inner_.connected(); }
+  void disconnect() override { inner_.disconnect(); }
+
+  std::vector<double> latenciesMs;
+  int64_t busyUs = 0;
+
+ private:
+  TelemetryTransport& inner_;
+};
+
+static const TimebaseConfig TIMEBASE = {1000, 60000, 5000000, 500};
+static const UploadConfig CONFIG = {5000, 60000, 6, 2};   // Low-power batching
+static const LatestStatus LATEST = {12.0f, 0.5f, 6.0f, false, "ARMED", 0.0f};
+static const int SAMPLES_PER_PROFILE = 120;                // 10 minutes of 5s samples
+
+alignas(8) static uint8_t poolStorage[6144];
+static char buffer[3072];
+static char response[65536];
+
+struct ProfileResult {
+  const char* profile;
+  double p50Ms;
+  double p99Ms;
+  double samplesPerSec;        // Delivered samples per second spent uploading
+  uint32_t produced;
+  uint32_t delivered;
+  uint32_t lost;
+  uint32_t pending;
+  uint32_t retries;
+  uint32_t failures;
+  uint32_t failedCycles;
+  int serverSamples;           // Keys present on the stand-in afterwards
+  bool synced;
+};
+
+static double percentile(std::vector<double> values, int percent) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  size_t rank = (percent * values.size() + 99) / 100;
+  return values[(rank > 1 ? rank : 1) - 1];
+}
+
+static int countServerKeys(const char* path) {
+  char target[128];
+  snprintf(target, sizeof(target), "/%s.json?shallow=true", path);
+  if (standin.get(target, response, sizeof(response)) != 200) return -1;
+  int keys = 0;
+  for (const char* p = response; (p = strstr(p, ":true")); p++) keys++;
+  return keys;
+}
+
+// Runs SAMPLES_PER_PROFILE samples; outageSamples of them (from sample 30)
+// are taken while the server answers every request with 503
+static ProfileResult runProfile(const char* profile, int outageSamples = 0) {
+  char settings[64];
+  snprintf(settings, sizeof(settings), "{\"profile\":\"%s\"}", profile);
+  TEST_ASSERT_TRUE(standin.reset());
+  TEST_ASSERT_TRUE(standin.configure(settings));
+
+  dateClock = HttpDateClock();
+  PosixRestTransport socket(standin.port(), &dateClock, realUs);
+  TimedTransport transport(socket);
+  TelemetryPool pool(poolStorage, sizeof(poolStorage));
+  TelemetryWriter writer(pool, buffer, sizeof(buffer));
+  Timebase timebase(TIMEBASE, harnessMonoUs, dateReference);
+  UploadPipeline pipeline(CONFIG, transport, writer, timebase, harnessMillis);
+  pipeline.setDevicePrefix("devices/harness/");
+
+  ProfileResult result = {};
+  result.profile = profile;
+  for (int i = 0; i < SAMPLES_PER_PROFILE; i++) {
+    if (outageSamples > 0 && i == 30) TEST_ASSERT_TRUE(standin.configure("{\"error_rate\":1}"));
+    if (outageSamples > 0 && i == 30 + outageSamples) TEST_ASSERT_TRUE(standin.configure(settings));
+    skippedUs += CONFIG.intervalMs * 1000LL;
+    timebase.service();
+    pipeline.queueSample({harnessMonoUs(), 12.0f, 0.5f, 6.0f, false});
+    result.produced++;
+    if (pipeline.due(harnessMillis()) && !pipeline.upload(LATEST, harnessMonoUs())) result.failedCycles++;
+  }
+  // Drain what is left, waiting out any backoff
+  for (int attempt = 0; attempt < 8 && pipeline.pendingSamples() > 0; attempt++) {
+    skippedUs += pipeline.backoffMs() * 1000LL;
+    timebase.service();
+    if (!pipeline.upload(LATEST, harnessMonoUs())) result.failedCycles++;
+  }
+
+  const UploadStats& stats = pipeline.stats();
+  result.p50Ms = percentile(transport.latenciesMs, 50);
+  result.p99Ms = percentile(transport.latenciesMs, 99);
+  result.delivered = stats.samplesDelivered;
+  result.lost = stats.samplesLost;
+  result.pending = pipeline.pendingSamples();
+  result.retries = stats.retries;
+  result.failures = stats.failures;
+  result.samplesPerSec = transport.busyUs ? stats.samplesDelivered * 1e6 / transport.busyUs : 0;
+  TEST_ASSERT_TRUE(standin.configure("{\"profile\":\"clean\"}"));   // Audit without faults
+  result.serverSamples = countServerKeys("devices/harness/sensor_data");
+  result.synced = timebase.synced();
+
+  char line[200];
+  snprintf(line, sizeof(line),
+           "%-8s p50 %6.1fms  p99 %6.1fms  %7.1f samples/s  retries %2lu  failed req %2lu  "
+           "lost %2lu/%lu  pending %lu",
+           profile, result.p50Ms, result.p99Ms, result.samplesPerSec, (unsigned long)result.retries,
+           (unsigned long)result.failures, (unsigned long)result.lost, (unsigned long)result.produced,
+           (unsigned long)result.pending);
+  TEST_MESSAGE(line);
+  return result;
+}
+
+// Every sample is delivered exactly once, lost to a full queue, or still queued
+static void assertAccounted(const ProfileResult& r) {
+  TEST_ASSERT_TRUE(r.synced);
+  TEST_ASSERT_EQUAL_UINT32(r.produced, r.delivered + r.lost + r.pending);
+  TEST_ASSERT_EQUAL((int)r.delivered, r.serverSamples);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_clean_and_lan_deliver_everything(void) {
+  for (const char* profile : {"clean", "lan"}) {
+    ProfileResult r = runProfile(profile);
+    assertAccounted(r);
+    TEST_ASSERT_EQUAL_UINT32(r.produced, r.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, r.retries);
+    TEST_ASSERT_EQUAL_UINT32(0, r.failedCycles);
+  }
+}
+
+void test_wan_latency_is_reported(void) {
+  ProfileResult r = runProfile("wan");
+  assertAccounted(r);
+  TEST_ASSERT_EQUAL_UINT32(r.produced, r.delivered);
+  TEST_ASSERT_GREATER_THAN(30, r.p50Ms);        // 60 +/- 25ms scripted
+  TEST_ASSERT_GREATER_OR_EQUAL(r.p50Ms, r.p99Ms);
+}
+
+void test_lossy_link_retries_dropped_requests(void) {
+  ProfileResult r = runProfile("lossy");
+  assertAccounted(r);
+  TEST_ASSERT_GREATER_THAN(0, r.retries);
+}
+
+void test_server_errors_back_off(void) {
+  for (const char* profile : {"errors", "degraded"}) {
+    ProfileResult r = runProfile(profile);
+    assertAccounted(r);
+    TEST_ASSERT_GREATER_THAN(0, r.failures);
+    TEST_ASSERT_GREATER_THAN(0, r.failedCycles);
+  }
+}
+
+void test_outage_drops_oldest_and_recovers(void) {
+  ProfileResult r = runProfile("lan", 36);   // 3 minutes of 503s
+  assertAccounted(r);
+  TEST_ASSERT_GREATER_THAN(0, r.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, r.pending);   // Drained once the server is back
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  if (!standin.start()) {
+    printf("IGNORE: python3 or tools/rtdb_standin.py not available\n");
+    return UNITY_END();
+  }
+  RUN_TEST(test_clean_and_lan_deliver_everything);
+  RUN_TEST(test_wan_latency_is_reported);
+  RUN_TEST(test_lossy_link_retries_dropped_requests);
+  RUN_TEST(test_server_errors_back_off);
+  RUN_TEST(test_outage_drops_oldest_and_recovers);
+  standin.stop();
+  return UNITY_END();
+}
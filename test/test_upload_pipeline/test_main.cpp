@@ -0,0 +1,444 @@
+// Upload queues, batching, retries and backoff against a scripted transport
+#include <unity.h>
+#include <UploadPipeline.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+struct SentRequest {
+  std::string method;
+  std::string path;
+  std::string body;
+};
+
+// Answers from a script of status codes (200 once the script runs out)
+class ScriptedTransport : public TelemetryTransport {
+ public:
+  std::vector<int> script;
+  std::vector<SentRequest> sent;
+  const char* getBody = "null";
+  std::map<std::string, std::string> getBodies;   // Per path, overrides getBody
+  bool open = false;
+  int disconnects = 0;
+
+  int request(const char* method, const char* path, const char* body, size_t length,
+              char* response, size_t responseSize) override {
+    sent.push_back({method, path, body ? std::string(body, length) : std::string()});
+    int status = 200;
+    if (!script.empty()) {
+      status = script.front();
+      script.erase(script.begin());
+    }
+    open = status >= 0;
+    if (status == 200 && response) {
+      auto found = getBodies.find(path);
+      strncpy(response, found != getBodies.end() ? found->second.c_str() : getBody, responseSize - 1);
+      response[responseSize - 1] = '\0';
+    }
+    return status;
+  }
+  bool connected() override { return open; }
+  void disconnect() override {
+    open = false;
+    disconnects++;
+  }
+};
+
+static uint32_t fakeMillis = 0;
+static int64_t fakeMonoUs = 0;
+static bool referenceValid = false;
+static const int64_t EPOCH_OFFSET_US = 1700000000000000LL;
+
+static uint32_t clockMillis() { return fakeMillis; }
+static int64_t fakeMonotonic() { return fakeMonoUs; }
+static bool fakeReference(int64_t* epochUs) {
+  if (!referenceValid) return false;
+  *epochUs = fakeMonoUs + EPOCH_OFFSET_US;
+  return true;
+}
+
+static const TimebaseConfig TIMEBASE = {1000, 60000, 5000000, 500};
+static const UploadConfig CONFIG = {5000, 60000, 3, 2};
+static const LatestStatus LATEST = {12.0f, 1.0f, 12.0f, false, "ARMED", 0.0f};
+
+alignas(8) static uint8_t poolStorage[6144];
+static char buffer[3072];
+
+struct Fixture {
+  TelemetryPool pool{poolStorage, sizeof(poolStorage)};
+  TelemetryWriter writer{pool, buffer, sizeof(buffer)};
+  ScriptedTransport transport;
+  Timebase timebase{TIMEBASE, fakeMonotonic, fakeReference};
+  UploadPipeline pipeline{CONFIG, transport, writer, timebase, clockMillis};
+
+  Fixture() { pipeline.setDevicePrefix("devices/esp32-test/"); }
+
+  void sync() {
+    referenceValid = true;
+    fakeMonoUs += 2000000;
+    timebase.service();
+  }
+
+  void queueSamples(int n) {
+    for (int i = 0; i < n; i++) {
+      fakeMonoUs += 5000000;
+      pipeline.queueSample({fakeMonoUs, 12.0f, 1.0f + i, 12.0f, false});
+    }
+  }
+};
+
+void setUp(void) {
+  fakeMillis = 100000;
+  fakeMonoUs = 10000000;
+  referenceValid = false;
+}
+
+void tearDown(void) {}
+
+void test_batch_is_one_patch_under_device_namespace(void) {
+  Fixture f;
+  f.sync();
+  f.queueSamples(2);
+  TEST_ASSERT_FALSE(f.pipeline.due(fakeMillis));
+  f.queueSamples(1);
+  TEST_ASSERT_TRUE(f.pipeline.due(fakeMillis));
+
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  TEST_ASSERT_EQUAL(2, (int)f.transport.sent.size());
+  TEST_ASSERT_EQUAL_STRING("devices/esp32-test/latest", f.transport.sent[0].path.c_str());
+  TEST_ASSERT_EQUAL_STRING("PATCH", f.transport.sent[1].method.c_str());
+  TEST_ASSERT_EQUAL_STRING("devices/esp32-test/sensor_data", f.transport.sent[1].path.c_str());
+
+  // Keys are epoch us of each capture time
+  JsonDocument doc;
+  deserializeJson(doc, f.transport.sent[1].body.c_str());
+  int entries = 0;
+  for (JsonPair entry : doc.as<JsonObject>()) entries += entry.key().c_str()[0] != '\0';
+  TEST_ASSERT_EQUAL(3, entries);
+  char key[20];
+  formatTimeKey(key, sizeof(key), f.timebase.epochUsAt(fakeMonoUs));
+  TEST_ASSERT_FALSE(doc[(const char*)key].isNull());
+  TEST_ASSERT_EQUAL_UINT32(3, f.pipeline.stats().samplesDelivered);
+  TEST_ASSERT_EQUAL(0, f.pipeline.pendingSamples());
+}
+
+void test_history_and_events_wait_for_the_clock(void) {
+  Fixture f;
+  f.queueSamples(3);
+  TEST_ASSERT_TRUE(f.pipeline.queueEvent(fakeMonoUs, {0.1f, 9.0f, 0.9f, "TRIPPED", 40, 0.2f}));
+
+  // Unsynced: only /latest goes out, without a timestamp, and that is not a failure
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  TEST_ASSERT_EQUAL(1, (int)f.transport.sent.size());
+  TEST_ASSERT_TRUE(f.transport.sent[0].body.find("timestamp") == std::string::npos);
+  TEST_ASSERT_EQUAL(3, f.pipeline.pendingSamples());
+  TEST_ASSERT_EQUAL(1, f.pipeline.pendingEvents());
+
+  // Once synced, the event keeps its original capture time
+  int64_t captured = fakeMonoUs;
+  f.sync();
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  TEST_ASSERT_EQUAL(4, (int)f.transport.sent.size());
+  char path[64] = "devices/esp32-test/short_circuit_events/";
+  formatTimeKey(path + strlen(path), sizeof(path) - strlen(path), f.timebase.epochUsAt(captured));
+  TEST_ASSERT_EQUAL_STRING(path, f.transport.sent[2].path.c_str());
+  TEST_ASSERT_EQUAL_STRING("PUT", f.transport.sent[2].method.c_str());
+  TEST_ASSERT_EQUAL(0, f.pipeline.pendingEvents());
+  TEST_ASSERT_EQUAL(0, f.pipeline.pendingSamples());
+}
+
+void test_only_connection_errors_are_retried(void) {
+  Fixture f;
+  f.transport.script = {-1, 200};
+  f.writer.setRaw("true");
+  TEST_ASSERT_TRUE(f.pipeline.send("PUT", "/flag"));
+  TEST_ASSERT_EQUAL(2, (int)f.transport.sent.size());
+  TEST_ASSERT_EQUAL(1, f.transport.disconnects);
+  TEST_ASSERT_EQUAL_UINT32(1, f.pipeline.stats().retries);
+
+  // Server errors wait for the next upload
+  f.transport.script = {503};
+  TEST_ASSERT_FALSE(f.pipeline.send("PUT", "/flag"));
+  TEST_ASSERT_EQUAL(3, (int)f.transport.sent.size());
+  TEST_ASSERT_EQUAL(503, f.pipeline.lastStatus());
+
+  // Two connection errors in a row give up
+  f.transport.script = {-1, -1};
+  TEST_ASSERT_FALSE(f.pipeline.send("PUT", "/flag"));
+  TEST_ASSERT_EQUAL(-1, f.pipeline.lastStatus());
+  TEST_ASSERT_EQUAL_UINT32(2, f.pipeline.stats().failures);
+  TEST_ASSERT_EQUAL_UINT32(5, f.pipeline.stats().requests);
+}
+
+void test_backoff_doubles_caps_and_clears(void) {
+  Fixture f;
+  f.sync();
+  f.queueSamples(3);
+  const uint32_t expected[] = {10000, 20000, 40000, 60000, 60000};
+  for (uint32_t backoff : expected) {
+    f.transport.script = {503, 503};
+    TEST_ASSERT_FALSE(f.pipeline.upload(LATEST, fakeMonoUs));
+    TEST_ASSERT_TRUE(f.pipeline.lastFailedSteps() & UPLOAD_STEP_LATEST);
+    TEST_ASSERT_TRUE(f.pipeline.lastFailedSteps() & UPLOAD_STEP_HISTORY);
+    TEST_ASSERT_EQUAL_UINT32(backoff, f.pipeline.backoffMs());
+    TEST_ASSERT_FALSE(f.pipeline.due(fakeMillis + backoff - 1));
+    fakeMillis += backoff;
+    TEST_ASSERT_TRUE(f.pipeline.due(fakeMillis));
+  }
+
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  TEST_ASSERT_EQUAL(0, f.pipeline.consecutiveFailures());
+  TEST_ASSERT_FALSE(f.pipeline.backingOff(fakeMillis));
+}
+
+void test_full_queues_drop_oldest_and_count_losses(void) {
+  Fixture f;
+  f.queueSamples(UPLOAD_HISTORY_MAX);
+  int64_t secondOldest = fakeMonoUs - (UPLOAD_HISTORY_MAX - 2) * 5000000LL;
+  f.queueSamples(1);
+  TEST_ASSERT_EQUAL(UPLOAD_HISTORY_MAX, f.pipeline.pendingSamples());
+  TEST_ASSERT_EQUAL_UINT32(1, f.pipeline.stats().samplesLost);
+
+  // The oldest sample is the one that went
+  f.sync();
+  f.pipeline.upload(LATEST, fakeMonoUs);
+  JsonDocument doc;
+  deserializeJson(doc, f.transport.sent.back().body.c_str());
+  char key[20];
+  formatTimeKey(key, sizeof(key), f.timebase.epochUsAt(secondOldest));
+  const char* firstKey = "";
+  for (JsonPair entry : doc.as<JsonObject>()) {
+    firstKey = entry.key().c_str();
+    break;
+  }
+  TEST_ASSERT_EQUAL_STRING(key, firstKey);
+
+  for (int i = 0; i < UPLOAD_EVENT_MAX; i++) TEST_ASSERT_TRUE(f.pipeline.queueEvent(i, {}));
+  TEST_ASSERT_FALSE(f.pipeline.queueEvent(99, {}));
+  TEST_ASSERT_EQUAL_UINT32(1, f.pipeline.stats().eventsLost);
+
+  // Minute buckets overflow their own queue; the hour bucket stays
+  RollupBucket hour = {};
+  hour.level = ROLLUP_HOUR;
+  TEST_ASSERT_TRUE(f.pipeline.queueRollup(hour));
+  RollupBucket bucket = {};
+  for (int i = 0; i < UPLOAD_MINUTE_ROLLUP_MAX; i++) TEST_ASSERT_TRUE(f.pipeline.queueRollup(bucket));
+  TEST_ASSERT_FALSE(f.pipeline.queueRollup(bucket));
+  TEST_ASSERT_EQUAL_UINT32(1, f.pipeline.stats().rollupsLost);
+  TEST_ASSERT_EQUAL(1, f.pipeline.pendingRollups(ROLLUP_HOUR));
+}
+
+void test_failed_event_keeps_the_rest_in_order(void) {
+  Fixture f;
+  f.sync();
+  // Three trips within one capture time still get distinct keys
+  for (int i = 0; i < 3; i++) f.pipeline.queueEvent(fakeMonoUs, {0, 0, 0, "TRIPPED", (uint32_t)i, 0});
+  f.transport.script = {200, 503};
+  TEST_ASSERT_FALSE(f.pipeline.flushEvents());
+  TEST_ASSERT_EQUAL(2, f.pipeline.pendingEvents());
+
+  TEST_ASSERT_TRUE(f.pipeline.flushEvents());
+  TEST_ASSERT_EQUAL(0, f.pipeline.pendingEvents());
+  TEST_ASSERT_EQUAL(4, (int)f.transport.sent.size());
+  TEST_ASSERT_TRUE(f.transport.sent[0].path < f.transport.sent[2].path);
+  TEST_ASSERT_TRUE(f.transport.sent[2].path == f.transport.sent[1].path);
+  TEST_ASSERT_TRUE(f.transport.sent[2].path < f.transport.sent[3].path);
+  TEST_ASSERT_TRUE(f.transport.sent[3].body.find("\"tripLatencyUs\":2") != std::string::npos);
+}
+
+void test_rollups_send_closed_and_open_buckets(void) {
+  Fixture f;
+  RollupAggregator rollups;
+  RollupBucket* open = rollups.open();
+  f.pipeline.setRollups(&rollups);
+
+  // Nothing to send: no request
+  f.pipeline.upload(LATEST, fakeMonoUs);
+  TEST_ASSERT_EQUAL(1, (int)f.transport.sent.size());
+
+  RollupBucket closed = {};
+  closed.level = 0;
+  closed.start = 1700000000;
+  closed.samples = 10;
+  f.pipeline.queueRollup(closed);
+  open[1].level = 1;
+  open[1].start = 1699999200;
+  open[1].samples = 4;
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  const SentRequest& patch = f.transport.sent.back();
+  TEST_ASSERT_EQUAL_STRING("devices/esp32-test/rollups", patch.path.c_str());
+  TEST_ASSERT_TRUE(patch.body.find("\"minute/1700000000\"") != std::string::npos);
+  TEST_ASSERT_TRUE(patch.body.find("\"hour/1699999200\"") != std::string::npos);
+  TEST_ASSERT_EQUAL(0, f.pipeline.pendingRollups());
+}
+
+// Feeds 5 s readings from start (inclusive) to end (exclusive); closed buckets
+// go to the pipeline as in updateRollups()
+static void feedRollups(Fixture& f, RollupAggregator& rollups, time_t start, time_t end, float power) {
+  RollupBucket closed[ROLLUP_LEVELS];
+  for (time_t t = start; t < end; t += 5) {
+    fakeMillis += 5000;
+    int count = rollups.add(fakeMillis, t, 12.0f, power / 12.0f, power, false, closed);
+    for (int i = 0; i < count; i++) f.pipeline.queueRollup(closed[i]);
+  }
+}
+
+static std::string sentBodies(const Fixture& f, const char* path) {
+  std::string bodies;
+  for (const SentRequest& request : f.transport.sent) {
+    if (request.path == path) bodies += request.body;
+  }
+  return bodies;
+}
+
+void test_outage_across_midnight_keeps_hour_and_day_buckets(void) {
+  Fixture f;
+  RollupAggregator rollups;
+  f.pipeline.setRollups(&rollups);
+  const time_t MIDNIGHT = 1700006400;
+
+  // 23:57 to 00:03 with WiFi down: no upload runs while minute buckets close
+  feedRollups(f, rollups, MIDNIGHT - 180, MIDNIGHT + 180, 12.0f);
+  TEST_ASSERT_EQUAL(UPLOAD_MINUTE_ROLLUP_MAX, f.pipeline.pendingRollups(ROLLUP_MINUTE));
+  TEST_ASSERT_EQUAL(1, f.pipeline.pendingRollups(ROLLUP_HOUR));
+  TEST_ASSERT_EQUAL(1, f.pipeline.pendingRollups(ROLLUP_DAY));
+  TEST_ASSERT_EQUAL_UINT32(1, f.pipeline.stats().rollupsLost);   // 23:57, the oldest minute
+
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  TEST_ASSERT_EQUAL(0, f.pipeline.pendingRollups());
+  std::string bodies = sentBodies(f, "devices/esp32-test/rollups");
+  TEST_ASSERT_TRUE(bodies.find("\"hour/1700002800\":{") != std::string::npos);
+  TEST_ASSERT_TRUE(bodies.find("\"day/1699920000\":{") != std::string::npos);
+  TEST_ASSERT_TRUE(bodies.find("\"minute/1700006280\"") != std::string::npos);
+  TEST_ASSERT_TRUE(bodies.find("\"minute/1700006220\"") == std::string::npos);
+  // Open buckets of the new hour and day follow the closed ones
+  TEST_ASSERT_TRUE(bodies.find("\"hour/1700006400\"") != std::string::npos);
+  TEST_ASSERT_TRUE(bodies.find("\"day/1700006400\"") != std::string::npos);
+
+  // The closed hour holds all of 23:57-23:59 (36 readings)
+  JsonDocument doc;
+  for (const SentRequest& request : f.transport.sent) {
+    if (request.body.find("\"hour/1700002800\"") == std::string::npos) continue;
+    deserializeJson(doc, request.body.c_str());
+    TEST_ASSERT_EQUAL(36, doc["hour/1700002800"][KEY_SAMPLES].as<int>());
+  }
+}
+
+void test_first_bucket_after_reboot_merges_server_copy(void) {
+  Fixture f;
+  RollupAggregator rollups;
+  f.pipeline.setRollups(&rollups);
+  const time_t HOUR = 1700002800;
+
+  // Before the reboot the device uploaded 40 minutes of this hour
+  f.transport.getBodies["devices/esp32-test/rollups/hour/1700002800"] =
+      "{\"vMin\":11.5,\"vMax\":12.5,\"vMean\":12,\"iMin\":0.5,\"iMax\":3,\"iMean\":1,"
+      "\"pMin\":6,\"pMax\":36,\"pMean\":12,\"energyWh\":8,\"faults\":2,\"samples\":480}";
+  feedRollups(f, rollups, HOUR + 2400, HOUR + 2460, 12.0f);
+
+  // A failed read-back holds the rollups instead of overwriting the server copy
+  f.transport.script = {200, 503};
+  TEST_ASSERT_FALSE(f.pipeline.upload(LATEST, fakeMonoUs));
+  TEST_ASSERT_EQUAL(UPLOAD_STEP_ROLLUPS, f.pipeline.lastFailedSteps());
+  TEST_ASSERT_TRUE(sentBodies(f, "devices/esp32-test/rollups").empty());
+
+  f.transport.sent.clear();
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  int gets = 0;
+  for (const SentRequest& request : f.transport.sent) gets += request.method == "GET";
+  TEST_ASSERT_EQUAL(3, gets);   // Minute, hour and day, once
+
+  JsonDocument doc;
+  deserializeJson(doc, sentBodies(f, "devices/esp32-test/rollups").c_str());
+  TEST_ASSERT_EQUAL(492, doc["hour/1700002800"][KEY_SAMPLES].as<int>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 11.5, doc["hour/1700002800"][KEY_V_MIN].as<float>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 3.0, doc["hour/1700002800"][KEY_I_MAX].as<float>());
+  TEST_ASSERT_EQUAL(2, doc["hour/1700002800"][KEY_FAULTS].as<int>());
+  // 8 Wh before the reboot plus 11 intervals of 5 s at 12 W
+  TEST_ASSERT_FLOAT_WITHIN(0.002, 8.183, doc["hour/1700002800"][KEY_ENERGY].as<float>());
+
+  f.transport.sent.clear();
+  feedRollups(f, rollups, HOUR + 2460, HOUR + 2520, 12.0f);
+  TEST_ASSERT_TRUE(f.pipeline.upload(LATEST, fakeMonoUs));
+  for (const SentRequest& request : f.transport.sent) TEST_ASSERT_TRUE(request.method != "GET");
+}
+
+void test_get_and_latency_percentiles(void) {
+  Fixture f;
+  f.transport.getBody = "true";
+  char flag[8];
+  TEST_ASSERT_EQUAL(200, f.pipeline.get("/control/cutoffReset", flag, sizeof(flag)));
+  TEST_ASSERT_EQUAL_STRING("true", flag);
+  TEST_ASSERT_EQUAL_STRING("devices/esp32-test/control/cutoffReset", f.transport.sent[0].path.c_str());
+
+  UploadStats stats = {};
+  TEST_ASSERT_EQUAL(0, uploadLatencyPercentile(stats, 50));
+  for (int i = 1; i <= 100; i++) {
+    stats.latencyMs[stats.latencyCount % UPLOAD_LATENCY_SAMPLES] = i;
+    if (++stats.latencyCount == 2 * UPLOAD_LATENCY_SAMPLES) stats.latencyCount = UPLOAD_LATENCY_SAMPLES;
+  }
+  // The ring holds 37..100 once it has wrapped
+  TEST_ASSERT_EQUAL(68, uploadLatencyPercentile(stats, 50));
+  TEST_ASSERT_EQUAL(100, uploadLatencyPercentile(stats, 99));
+  TEST_ASSERT_EQUAL(37, uploadLatencyPercentile(stats, 0));
+}
+
+void test_pacer_phase_and_jitter_stay_in_bounds(void) {
+  uint32_t firstDue[2];
+  for (uint32_t seed = 1; seed <= 2; seed++) {
+    UploadPacer pacer(5000, 1000);
+    pacer.start(100000, seed * 2654435761u);
+    uint32_t now = 100000;
+    while (!pacer.due(now)) now++;
+    firstDue[seed - 1] = now;
+    TEST_ASSERT_LESS_THAN(100000 + 5000, now);   // Phase within one period
+
+    // Each fire lands within the jitter after its slot on the fixed schedule
+    uint32_t jitterTotal = 0;
+    for (uint32_t slot = 1; slot <= 1000; slot++) {
+      while (!pacer.due(++now)) {}
+      uint32_t slotStart = firstDue[seed - 1] + slot * 5000;
+      TEST_ASSERT_GREATER_OR_EQUAL(slotStart, now);
+      TEST_ASSERT_LESS_OR_EQUAL(slotStart + 1000, now);
+      jitterTotal += now - slotStart;
+    }
+    // So the average period is the period, not period + mean jitter
+    TEST_ASSERT_LESS_OR_EQUAL(firstDue[seed - 1] + 1000 * 5000 + 1000, now);
+    TEST_ASSERT_INT_WITHIN(100, 500, jitterTotal / 1000);
+  }
+  // Different seeds start at different phases
+  TEST_ASSERT_TRUE(firstDue[0] != firstDue[1]);
+}
+
+void test_pacer_skips_slots_missed_while_blocked(void) {
+  UploadPacer pacer(5000, 1000);
+  pacer.start(0, 12345);
+  uint32_t now = 0;
+  while (!pacer.due(now)) now++;
+  uint32_t phase = now;
+  // Blocked for 3.5 periods: one fire for the late slot, then back on schedule
+  now += 17500;
+  TEST_ASSERT_TRUE(pacer.due(now));
+  TEST_ASSERT_FALSE(pacer.due(now));
+  while (!pacer.due(++now)) {}
+  TEST_ASSERT_GREATER_OR_EQUAL(phase + 4 * 5000, now);
+  TEST_ASSERT_LESS_OR_EQUAL(phase + 4 * 5000 + 1000, now);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_batch_is_one_patch_under_device_namespace);
+  RUN_TEST(test_history_and_events_wait_for_the_clock);
+  RUN_TEST(test_only_connection_errors_are_retried);
+  RUN_TEST(test_backoff_doubles_caps_and_clears);
+  RUN_TEST(test_full_queues_drop_oldest_and_count_losses);
+  RUN_TEST(test_failed_event_keeps_the_rest_in_order);
+  RUN_TEST(test_rollups_send_closed_and_open_buckets);
+  RUN_TEST(test_outage_across_midnight_keeps_hour_and_day_buckets);
+  RUN_TEST(test_first_bucket_after_reboot_merges_server_copy);
+  RUN_TEST(test_get_and_latency_percentiles);
+  RUN_TEST(test_pacer_phase_and_jitter_stay_in_bounds);
+  RUN_TEST(test_pacer_skips_slots_missed_while_blocked);
+  return UNITY_END();
+}
@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Firebase Realtime Database REST API.
+
+Serves the subset the firmware uses (GET/PUT/PATCH/DELETE on <path>.json,
+multi-path PATCH, null deletes, shallow=true and orderBy="$key" range
+queries) from an in-memory tree, with scripted network conditions:
+
+  latency_ms   fixed delay before each response
+  jitter_ms    +/- uniform jitter on top of the latency
+  drop         probability of closing the connection without a response
+  error_rate   probability of answering 503 instead of applying the request
+
+Dropped and failed requests are never applied, so the server state always
+matches what the client saw acknowledged. Every response carries a Date
+header, which the firmware uses as a time reference when there is no NTP.
+
+Control endpoints (never delayed or faulted):
+  POST /__control   {"profile": "wan"} and/or individual knobs
+  GET  /__stats     request/fault counters
+  POST /__reset     clears the tree and the counters
+
+Usage:
+  tools/rtdb_standin.py --port 8080 --profile lan
+Point REST_BASE_URL in src/main.cpp at http://<host>:8080/ to run the
+device against it; the native tests start it themselves (port 0) and read
+the "READY <port>" line.
+"""
+
+import argparse
+import json
+import random
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, unquote, urlsplit
+
+PROFILES = {
+    "clean":    {"latency_ms": 0,  "jitter_ms": 0,  "drop": 0.0,  "error_rate": 0.0},
+    "lan":      {"latency_ms": 5,  "jitter_ms": 2,  "drop": 0.0,  "error_rate": 0.0},
+    "wan":      {"latency_ms": 60, "jitter_ms": 25, "drop": 0.0,  "error_rate": 0.0},
+    "lossy":    {"latency_ms": 60, "jitter_ms": 25, "drop": 0.05, "error_rate": 0.0},
+    "errors":   {"latency_ms": 5,  "jitter_ms": 2,  "drop": 0.0,  "error_rate": 0.10},
+    "degraded": {"latency_ms": 60, "jitter_ms": 25, "drop": 0.05, "error_rate": 0.05},
+}
+KNOBS = ("latency_ms", "jitter_ms", "drop", "error_rate")
+
+
+class Database:
+    def __init__(self, seed):
+        self.lock = threading.Lock()
+        self.rng = random.Random(seed)
+        self.knobs = dict(PROFILES["clean"])
+        self.profile = "clean"
+        self.reset()
+
+    def reset(self):
+        self.root = {}
+        self.stats = {"requests": 0, "applied": 0, "dropped": 0, "errors": 0,
+                      "bytesIn": 0, "byMethod": {}}
+
+    def configure(self, settings):
+        if "profile" in settings:
+            self.knobs = dict(PROFILES[settings["profile"]])
+            self.profile = settings["profile"]
+        for knob in KNOBS:
+            if knob in settings:
+                self.knobs[knob] = float(settings[knob])
+                self.profile = "custom"
+
+    # Tree access. Paths are lists of keys; None/empty values delete.
+    def get(self, parts):
+        node = self.root
+        for part in parts:
+            if not isinstance(node, dict) or part not in node:
+                return None
+            node = node[part]
+        return node
+
+    def set(self, parts, value):
+        if not parts:
+            self.root = value if isinstance(value, dict) else {}
+            return
+        node = self.root
+        trail = []
+        for part in parts[:-1]:
+            child = node.get(part)
+            if not isinstance(child, dict):
+                if value is None:
+                    return
+                child = node[part] = {}
+            trail.append((node, part))
+            node = child
+        if value is None or value == {}:
+            node.pop(parts[-1], None)
+            # Empty parents disappear, like in the RTDB
+            for parent, key in reversed(trail):
+                if parent[key]:
+                    break
+                del parent[key]
+        else:
+            node[parts[-1]] = value
+
+
+def split_path(path):
+    path = unquote(path)
+    if path.endswith(".json"):
+        path = path[:-5]
+    return [part for part in path.split("/") if part]
+
+
+def query(node, params):
+    if not isinstance(node, dict):
+        return node
+    if params.get("shallow") == ["true"]:
+        return {key: True for key in node}
+    if "orderBy" not in params:
+        return node
+    keys = sorted(node)
+    if "startAt" in params:
+        start = json.loads(params["startAt"][0])
+        keys = [key for key in keys if key >= start]
+    if "endAt" in params:
+        end = json.loads(params["endAt"][0])
+        keys = [key for key in keys if key <= end]
+    if "limitToFirst" in params:
+        keys = keys[:int(params["limitToFirst"][0])]
+    return {key: node[key] for key in keys}
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # Keep-alive, like the device's REST session
+    disable_nagle_algorithm = True  # Headers and body go out separately; don't add ACK delays
+    db = None
+    verbose = False
+
+    def log_message(self, fmt, *args):
+        if self.verbose:
+            sys.stderr.write("%s\n" % (fmt % args))
+
+    def reply(self, status, value):
+        body = json.dumps(value, separators=(",", ":")).encode()
+        self.send_response(status)   # Adds the Date header
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        data = self.rfile.read(length) if length else b""
+        return data
+
+    def control(self, path, data):
+        db = self.db
+        with db.lock:
+            if path == "/__control" and self.command == "POST":
+                db.configure(json.loads(data or b"{}"))
+                return self.reply(200, dict(db.knobs, profile=db.profile))
+            if path == "/__stats":
+                return self.reply(200, dict(db.stats, profile=db.profile))
+            if path == "/__reset" and self.command == "POST":
+                db.reset()
+                return self.reply(200, True)
+        return self.reply(404, {"error": "unknown control endpoint"})
+
+    def handle_any(self):
+        url = urlsplit(self.path)
+        data = self.read_body()
+        if url.path.startswith("/__"):
+            return self.control(url.path, data)
+
+        db = self.db
+        with db.lock:
+            knobs = dict(db.knobs)
+            roll_drop = db.rng.random()
+            roll_error = db.rng.random()
+            delay = knobs["latency_ms"] + db.rng.uniform(-knobs["jitter_ms"], knobs["jitter_ms"])
+            db.stats["requests"] += 1
+            db.stats["bytesIn"] += len(data)
+            db.stats["byMethod"][self.command] = db.stats["byMethod"].get(self.command, 0) + 1
+
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+        if roll_drop < knobs["drop"]:
+            with db.lock:
+                db.stats["dropped"] += 1
+            self.close_connection = True
+            return
+        if roll_error < knobs["error_rate"]:
+            with db.lock:
+                db.stats["errors"] += 1
+            return self.reply(503, {"error": "injected"})
+
+        parts = split_path(url.path)
+        try:
+            value = json.loads(data) if data else None
+        except ValueError:
+            return self.reply(400, {"error": "Invalid data; couldn't parse JSON object."})
+
+        with db.lock:
+            if self.command == "GET":
+                result = query(db.get(parts), parse_qs(url.query))
+            elif self.command == "PUT":
+                db.set(parts, value)
+                result = value
+            elif self.command == "PATCH":
+                if not isinstance(value, dict):
+                    return self.reply(400, {"error": "PATCH body must be an object"})
+                for key, child in value.items():
+                    db.set(parts + [k for k in key.split("/") if k], child)
+                result = value
+            elif self.command == "DELETE":
+                db.set(parts, None)
+                result = None
+            else:
+                return self.reply(405, {"error": "method not allowed"})
+            if self.command != "GET":
+                db.stats["applied"] += 1
+        return self.reply(200, result)
+
+    do_GET = do_PUT = do_PATCH = do_DELETE = do_POST = handle_any
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080, help="0 picks a free port")
+    parser.add_argument("--profile", choices=sorted(PROFILES), default="clean")
+    parser.add_argument("--seed", type=int, default=1, help="fault injection is reproducible per seed")
+    parser.add_argument("--verbose", action="store_true")
+    for knob in KNOBS:
+        parser.add_argument("--" + knob.replace("_", "-"), type=float)
+    args = parser.parse_args()
+
+    db = Database(args.seed)
+    db.configure({"profile": args.profile})
+    db.configure({k: getattr(args, k) for k in KNOBS if getattr(args, k) is not None})
+    Handler.db = db
+    Handler.verbose = args.verbose
+
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    server.daemon_threads = True
+    print("READY %d" % server.server_address[1], flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()